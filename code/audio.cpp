@@ -1,6 +1,7 @@
 #include "audio.hpp"
 #include "fileio.hpp"
 #include "log.hpp"
+#include "profiler.hpp"
 #include <fmod/inc/fmod.hpp>
 #include <fmod/inc/fmod_studio.hpp>
 #include <fmod/inc/fmod_errors.h>
@@ -80,6 +81,7 @@ namespace xs::audio
 
 	void update(double dt)
 	{
+		XS_MEMORY_TAG(audio);
 		system->update();
 
 		// remove released events from the hashmap?
@@ -98,6 +100,7 @@ namespace xs::audio
 
 	int load(const std::string& filename, int group_id)
 	{
+		XS_MEMORY_TAG(audio);
 		// check if the sound already exists
 		int hash = static_cast<int>(std::hash<std::string>{}(filename));
 		if (sounds.find(hash) != sounds.end())
@@ -237,6 +240,7 @@ namespace xs::audio
 
 	int load_bank(const std::string& filename)
 	{
+		XS_MEMORY_TAG(audio);
 		// check if the bank already exists
 		int hash = static_cast<int>(std::hash<std::string>{}(filename));
 		if (banks.find(hash) != banks.end())
@@ -47,6 +47,48 @@ bool xs::configuration::window_size_in_points()
     return data::get_bool("Window size in points", data::type::project);
 }
 
+// Read every frame, so these look their values up by interned key
+bool xs::configuration::fixed_timestep()
+{
+	static const auto key = data::intern("Fixed timestep");
+	return data::get_bool(key, data::type::project);
+}
+
+double xs::configuration::update_rate()
+{
+	static const auto key = data::intern("Update rate");
+	double rate = data::get_number(key, data::type::project);
+	return rate > 0.0 ? rate : 60.0;
+}
+
+int xs::configuration::max_updates_per_frame()
+{
+	static const auto key = data::intern("Max updates per frame");
+	int max_updates = (int)data::get_number(key, data::type::project);
+	return max_updates > 0 ? max_updates : 4;
+}
+
+bool xs::configuration::render_thread()
+{
+	return data::get_bool("Render thread", data::type::project);
+}
+
+std::string xs::configuration::frame_pacing()
+{
+	return data::get_string("Frame pacing", data::type::project);
+}
+
+double xs::configuration::target_fps()
+{
+	double fps = data::get_number("Target FPS", data::type::project);
+	return fps > 0.0 ? fps : 60.0;
+}
+
+bool xs::configuration::binary_save_data()
+{
+	return data::get_bool("Binary save data", data::type::project);
+}
+
 /*
 bool xs::configuration::msaa_enabled()
 {
@@ -20,6 +20,27 @@ namespace xs::configuration
 	/// Point are used on screens with HDPI
 	bool window_size_in_points();
 
+	/// Update the game in fixed steps, independent of the display rate
+	bool fixed_timestep();
+
+	/// Fixed updates per second (when fixed_timestep is on)
+	double update_rate();
+
+	/// Most fixed updates in one frame, the rest of the backlog is dropped
+	int max_updates_per_frame();
+
+	/// Draw and present on a separate thread that owns the graphics context (builds without the inspector only)
+	bool render_thread();
+
+	/// How frames are paced: vsync (default), adaptive, fps or uncapped
+	std::string frame_pacing();
+
+	/// Frame rate to hold in the fps pacing mode
+	double target_fps();
+
+	/// Write player and user data as MessagePack instead of JSON (smaller and faster for large saves)
+	bool binary_save_data();
+
 	/// Multisample anti-aliasing enabled
 	// bool msaa_enabled();
 
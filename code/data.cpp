@@ -1,13 +1,21 @@
 #include "data.hpp"
 #include <unordered_map>
+#include <deque>
+#include <optional>
 #include <memory>
 #include <any>
 #include <variant>
 #include <fstream>
+#include <mutex>
+#include <atomic>
+#include <cstring>
 #include "log.hpp"
+#include "jobs.hpp"
+#include "configuration.hpp"
 #include "render.hpp"
 #include "tools.hpp"
 #include "fileio.hpp"
+#include "profiler.hpp"
 #include "inspector.hpp"
 #include "json/json.hpp"
 #include "imgui/imgui.h"
@@ -31,14 +39,69 @@ namespace xs::data::internal
 	using regsitry_type = std::unordered_map<std::string, registry_value>;
 	regsitry_type reg;
 
-	vector<regsitry_type> history;
-	int history_stack_pointer;
+	// Undo history is a log of changes to single entries. An empty value means the entry
+	// didn't exist (before it was added, or after it was deleted).
+	struct change
+	{
+		std::string name;
+		std::optional<registry_value> before;
+		std::optional<registry_value> after;
+		double time = 0.0;
+	};
+
+	// Changes to the same entry this close together are undone as one
+	constexpr double c_coalesce_seconds = 1.0;
+	constexpr size_t c_max_history = 512;
+
+	std::deque<change> history;
+	size_t history_position = 0;	// Number of changes applied, the rest can be redone
+
+	// Copy of the values of one type, to write away from the main thread
+	struct save_request
+	{
+		std::string path;
+		bool binary = false;
+		vector<std::pair<std::string, registry_value>> entries;
+	};
+
+	// At most one write per type is running, a newer save waits here and replaces older ones
+	struct save_slot
+	{
+		bool writing = false;
+		std::optional<save_request> queued;
+	};
+
+	std::unordered_map<xs::data::type, save_slot> save_slots;
+	std::mutex save_mutex;
+	jobs::counter save_jobs;
+	std::atomic<int> saves_in_flight = 0;
+
+	// Entry being edited, as it was when the widget became active
+	std::string pending_name;
+	std::optional<registry_value> pending_before;
 
 	std::unordered_map<xs::data::type, bool> edited;
 
+	// Interned names point straight at their value in the registry. Nodes of an unordered_map
+	// don't move, so the pointers only go stale when entries are added, removed or replaced,
+	// which bumps the generation and makes every key look its value up again.
+	struct interned_key
+	{
+		std::string name;
+		registry_value* value = nullptr;
+		uint32_t generation = 0;
+	};
+
+	vector<interned_key> keys;
+	std::unordered_map<std::string, key> key_lookup;
+	uint32_t generation = 1;
+
 	template<class T>
 	T get(const std::string& name, type type);
 
+	template<class T>
+	T get(key k, type type);
+
 	template<typename T>
 	void set(const std::string& name, const T& reg_value, type type, bool active = false);
 
@@ -65,9 +128,19 @@ namespace xs::data::internal
 	bool inspect_entry(std::pair<const std::string, registry_value>& itr);
 	void inspect_of_type(const std::string& name, const std::string& icon, type type);
 	void load_of_type(type type);
+	save_request make_save_request(type type);
+	bool write_save(const save_request& request);
+	void write_saves(type type, save_request request);
 	const string& get_file_path(type type);
 
 	void tooltip(const char* tooltip);
+	void begin_edit(const std::pair<const std::string, registry_value>& itr);
+	void end_edit(const std::pair<const std::string, registry_value>& itr);
+	void record(
+		const std::string& name,
+		const std::optional<registry_value>& before,
+		const std::optional<registry_value>& after);
+	void apply(const std::string& name, const std::optional<registry_value>& value);
 	void undo();
 	void redo();
 }
@@ -78,31 +151,66 @@ T xs::data::internal::get(const std::string& name, type type)
 	auto itr = internal::reg.find(name);
 	if (itr != internal::reg.end())
 	{	
-		try
+		auto val = std::get_if<T>(&itr->second.value);
+		if (val)
 		{
-			auto val = std::get<T>(itr->second.value);
 			itr->second.active = true;
-			return val;
-		}
-		catch (...)
-		{			
-			xs::log::warn("Data value with name '{}' is of different type.", name);
+			return *val;
 		}
+		xs::log::warn("Data value with name '{}' is of different type.", name);
 	}
 	else
 	{
 		xs::log::warn("Data value with name '{}' not found. Adding default to data.", name);
 		T t = {};
 		internal::reg[name] = { type, t, true };
+		generation++;
 	}
 	
 	return {};
 }
 
+template<class T>
+T xs::data::internal::get(key k, type type)
+{
+	if (k >= keys.size())
+	{
+		xs::log::warn("Data key {} was never interned.", k);
+		return {};
+	}
+
+	auto& ik = keys[k];
+	if (ik.generation != generation)
+	{
+		auto itr = reg.find(ik.name);
+		ik.value = itr != reg.end() ? &itr->second : nullptr;
+		ik.generation = generation;
+	}
+
+	if (ik.value)
+	{
+		auto val = std::get_if<T>(&ik.value->value);
+		if (val)
+		{
+			ik.value->active = true;
+			return *val;
+		}
+		xs::log::warn("Data value with name '{}' is of different type.", ik.name);
+		return {};
+	}
+
+	// Missing, so take the slow path that warns and adds the default
+	return get<T>(ik.name, type);
+}
+
 template<typename T>
 void xs::data::internal::set(const std::string& name, const T& value, type type, bool active)
 {
-	internal::reg[name] = { type, value, active };
+	XS_MEMORY_TAG(data);
+	auto [itr, inserted] = internal::reg.try_emplace(name);
+	itr->second = { type, value, active };
+	if (inserted)
+		generation++;
 }
 
 using namespace xs::data::internal;
@@ -118,10 +226,13 @@ void xs::data::initialize()
 
 void xs::data::shutdown()
 {
+	flush_saves();
 	reg.clear();
 	history.clear();	
 	edited.clear();
-	history_stack_pointer = 0;
+	history_position = 0;
+	pending_before.reset();
+	generation++;
 }
 
 // Render inspector at a fixed rectangle (no title bar)
@@ -163,6 +274,38 @@ std::string xs::data::get_string(const std::string& name, type type)
 	return get<string>(name, type);
 }
 
+xs::data::key xs::data::intern(const std::string& name)
+{
+	auto itr = key_lookup.find(name);
+	if (itr != key_lookup.end())
+		return itr->second;
+
+	key k = (key)keys.size();
+	keys.push_back({ name });
+	key_lookup[name] = k;
+	return k;
+}
+
+double xs::data::get_number(key k, type type)
+{
+	return get<double>(k, type);
+}
+
+uint32_t xs::data::get_color(key k, type type)
+{
+	return get<uint32_t>(k, type);
+}
+
+bool xs::data::get_bool(key k, type type)
+{
+	return get<bool>(k, type);
+}
+
+std::string xs::data::get_string(key k, type type)
+{
+	return get<string>(k, type);
+}
+
 void xs::data::set_number(const std::string& name, double value, type tp)
 {
 	xs::data::internal::set<double>(name, value, tp);
@@ -209,13 +352,7 @@ void xs::data::internal::inspect_of_type(
 	{
 		tooltip(name.c_str());
 
-		if (history.empty())
-		{
-			auto r(reg);
-			history.push_back(r);
-		}
-
-		ImGui::BeginDisabled(!(internal::history_stack_pointer < history.size() - 1));
+		ImGui::BeginDisabled(internal::history_position == 0);
 		if (ImGui::Button(ICON_FI_UNDO))
 		{
 			internal::undo();
@@ -224,7 +361,7 @@ void xs::data::internal::inspect_of_type(
 		ImGui::EndDisabled();
 		ImGui::SameLine();
 
-		ImGui::BeginDisabled(internal::history_stack_pointer == 0);
+		ImGui::BeginDisabled(internal::history_position == history.size());
 		if (ImGui::Button(ICON_FI_REDO))
 		{
 			internal::redo();
@@ -277,60 +414,78 @@ void xs::data::internal::inspect_of_type(
 
 void xs::data::save_of_type(type type)
 {
-	nlohmann::json j;
-	for (auto& itr : reg)
+	XS_MEMORY_TAG(data);
+
+	// A background save of this type that lands later would overwrite this one
+	flush_saves();
+	write_save(make_save_request(type));
+	edited[type] = false;
+}
+
+void xs::data::save_async(type type)
+{
+	XS_MEMORY_TAG(data);
+	auto request = make_save_request(type);
+	edited[type] = false;
+
 	{
-		if (itr.second.data_type == type)
+		lock_guard<mutex> lock(save_mutex);
+		auto& slot = save_slots[type];
+		if (slot.writing)
 		{
-			auto val_double = std::get_if<double>(&itr.second.value);
-			auto val_bool = std::get_if<bool>(&itr.second.value);
-			auto val_uint32_t = std::get_if<uint32_t>(&itr.second.value);
-			auto val_string = std::get_if<string>(&itr.second.value);
-			if (val_double)
-			{
-				j[itr.first]["value"] = *val_double;
-				j[itr.first]["type"] = "number";
-			}
-			else if (val_bool)
-			{
-				j[itr.first]["value"] = *val_bool;
-				j[itr.first]["type"] = "bool";
-			}
-			else if (val_uint32_t)
-			{
-				j[itr.first]["value"] = *val_uint32_t;
-				j[itr.first]["type"] = "color";
-			}
-			else if (val_string)
-			{
-				j[itr.first]["value"] = *val_string;
-				j[itr.first]["type"] = "string";
-			}
+			slot.queued = std::move(request);
+			return;
 		}
+		slot.writing = true;
+		saves_in_flight++;
 	}
-	
-	auto filename = fileio::get_path(get_file_path(type));
-	std::ofstream ofs;
-	ofs.open(filename);
-	if (ofs.is_open())
-	{
-		auto str = j.dump(4);
-		ofs << str;
-		ofs.close();
+
+	if (jobs::worker_count() == 0)
+	{
+		write_saves(type, std::move(request));
+		return;
 	}
 
-	edited[type] = false;
+	jobs::submit([type, request = std::move(request)]() mutable {
+		write_saves(type, std::move(request));
+	}, &save_jobs, jobs::affinity::any, "xs::data::save");
+}
+
+bool xs::data::saving()
+{
+	return saves_in_flight > 0;
+}
+
+void xs::data::flush_saves()
+{
+	jobs::wait(save_jobs);
 }
 
 void xs::data::internal::load_of_type(type type)
 {	
+	XS_MEMORY_TAG(data);
 	auto filename = get_file_path(type);	
 	if(fileio::exists(filename))
 	{
-		auto file = fileio::read_text_file(filename);
+		auto file = fileio::read_binary_file(filename);
 		if (!file.empty())
 		{
-			nlohmann::json j = nlohmann::json::parse(file);
+			// Binary saves are MessagePack, which starts with a map marker where JSON has text
+			const auto begin = reinterpret_cast<const uint8_t*>(file.data());
+			const auto end = begin + file.size();
+			const bool binary = (*begin >= 0x80 && *begin <= 0x8f) || *begin == 0xde || *begin == 0xdf;
+
+			nlohmann::json j;
+			try
+			{
+				j = binary ? nlohmann::json::from_msgpack(begin, end) : nlohmann::json::parse(begin, end);
+			}
+			catch (const std::exception& e)
+			{
+				xs::log::error("Data file '{}' could not be read: {}", filename, e.what());
+				return;
+			}
+
 			for (auto it = j.begin(); it != j.end(); ++it)
 			{
 				auto name = it.key();
@@ -354,6 +509,88 @@ void xs::data::internal::load_of_type(type type)
 	}
 }
 
+xs::data::internal::save_request xs::data::internal::make_save_request(type type)
+{
+	save_request request;
+	request.path = fileio::get_path(get_file_path(type));
+	request.binary =
+		(type == xs::data::type::player || type == xs::data::type::user) &&
+		configuration::binary_save_data();
+	for (auto& itr : reg)
+		if (itr.second.data_type == type)
+			request.entries.push_back(itr);
+	return request;
+}
+
+bool xs::data::internal::write_save(const save_request& request)
+{
+	XS_MEMORY_TAG(data);
+	nlohmann::json j;
+	for (auto& itr : request.entries)
+	{
+		auto val_double = std::get_if<double>(&itr.second.value);
+		auto val_bool = std::get_if<bool>(&itr.second.value);
+		auto val_uint32_t = std::get_if<uint32_t>(&itr.second.value);
+		auto val_string = std::get_if<string>(&itr.second.value);
+		if (val_double)
+		{
+			j[itr.first]["value"] = *val_double;
+			j[itr.first]["type"] = "number";
+		}
+		else if (val_bool)
+		{
+			j[itr.first]["value"] = *val_bool;
+			j[itr.first]["type"] = "bool";
+		}
+		else if (val_uint32_t)
+		{
+			j[itr.first]["value"] = *val_uint32_t;
+			j[itr.first]["type"] = "color";
+		}
+		else if (val_string)
+		{
+			j[itr.first]["value"] = *val_string;
+			j[itr.first]["type"] = "string";
+		}
+	}
+
+	// Swapped in whole, so a crash while writing leaves the old file intact
+	vector<std::byte> bytes;
+	if (request.binary)
+	{
+		const auto packed = nlohmann::json::to_msgpack(j);
+		bytes.resize(packed.size());
+		memcpy(bytes.data(), packed.data(), packed.size());
+	}
+	else
+	{
+		const auto text = j.dump(4);
+		bytes.resize(text.size());
+		memcpy(bytes.data(), text.data(), text.size());
+	}
+	return fileio::replace_file(bytes, request.path);
+}
+
+void xs::data::internal::write_saves(type type, save_request request)
+{
+	// Keep writing while saves for this type were queued in the meantime
+	while (true)
+	{
+		write_save(request);
+
+		lock_guard<mutex> lock(save_mutex);
+		auto& slot = save_slots[type];
+		if (!slot.queued)
+		{
+			slot.writing = false;
+			break;
+		}
+		request = std::move(*slot.queued);
+		slot.queued.reset();
+	}
+	saves_in_flight--;
+}
+
 const string& xs::data::internal::get_file_path(type type)
 {
 	static std::string game_path = "[game]/game.json";
@@ -420,7 +657,13 @@ bool xs::data::internal::inspect_entry(
 						if (is_selected)
 							ImGui::SetItemDefaultFocus();
 					}
+					// A pick from the list is a whole edit
+					std::optional<registry_value> before;
+					if (edited)
+						before = itr.second;
 					set(itr.first, (double)vint, itr.second.data_type, itr.second.active);
+					if (edited)
+						record(itr.first, before, itr.second);
 					ImGui::EndCombo();
 				}
 				ImGui::PopID();
@@ -431,7 +674,9 @@ bool xs::data::internal::inspect_entry(
 				auto val = std::get<double>(itr.second.value);
 				float flt = (float)val;
 				edited = ImGui::DragFloat(itr.first.c_str(), &flt, 0.01f);
+				begin_edit(itr);
 				set(itr.first, flt, itr.second.data_type, itr.second.active);
+				end_edit(itr);
 			}
 		}
 	}
@@ -441,7 +686,9 @@ bool xs::data::internal::inspect_entry(
 		if (val)
 		{
 			edited = ImGui::Checkbox(itr.first.c_str(), val);
+			begin_edit(itr);
 			set(itr.first, *val, itr.second.data_type, itr.second.active);
+			end_edit(itr);
 		}
 	}
 
@@ -451,8 +698,10 @@ bool xs::data::internal::inspect_entry(
 		{
 			ImVec4 vec = color_convert(*val);
 			edited = ImGui::ColorEdit4(itr.first.c_str(), &vec.x);
+			begin_edit(itr);
 			*val = color_convert(vec);
 			set(itr.first, *val, itr.second.data_type, itr.second.active);
+			end_edit(itr);
 		}
 	}
 
@@ -463,23 +712,12 @@ bool xs::data::internal::inspect_entry(
 			ImGui::PushItemWidth(0);
 			edited = ImGui::InputText(itr.first.c_str(), val);
 			ImGui::PopItemWidth();
+			begin_edit(itr);
 			set(itr.first, *val, itr.second.data_type);
+			end_edit(itr);
 		}
 	}
 
-	if (ImGui::IsItemDeactivatedAfterEdit())
-	{
-		if (history_stack_pointer > 0)
-		{
-			history.resize(history.size() - history_stack_pointer);
-			history_stack_pointer = 0;
-		}
-
-		regsitry_type r(reg);
-		history.push_back(r);
-	}
-
-
 	if (!itr.second.active)
 	{
 		ImGui::SameLine();
@@ -491,10 +729,11 @@ bool xs::data::internal::inspect_entry(
 
 		if (ImGui::Button(ICON_FI_DELETE))
 		{
-			reg.erase(itr.first);
+			auto name = itr.first;
+			record(name, itr.second, std::nullopt);
+			reg.erase(name);
+			generation++;
 			edited = true;
-			regsitry_type r(reg);
-			history.push_back(r);
 		}
 		ImGui::PopID();
 
@@ -514,27 +753,106 @@ void xs::data::internal::tooltip(const char* tooltip)
 	}
 }
 
-void xs::data::internal::undo()
+void xs::data::internal::begin_edit(const std::pair<const std::string, registry_value>& itr)
 {
-	if(internal::history_stack_pointer < history.size() - 1)
-		internal::history_stack_pointer++;
-
-	size_t idx = history.size() - 1 - history_stack_pointer;
-	if (idx < history.size() && idx >= 0) {
-		regsitry_type& r = history[idx];
-		reg = r;
+	// Widgets only change the value on the frames after they become active
+	if (ImGui::IsItemActivated())
+	{
+		pending_name = itr.first;
+		pending_before = itr.second;
 	}
 }
 
-void xs::data::internal::redo()
+void xs::data::internal::end_edit(const std::pair<const std::string, registry_value>& itr)
 {
-	if (internal::history_stack_pointer > 0)
-		internal::history_stack_pointer--;
+	// A whole drag (or typing into a field) is one change
+	if (!ImGui::IsItemDeactivated())
+		return;
+
+	if (ImGui::IsItemDeactivatedAfterEdit() && pending_before && pending_name == itr.first)
+		record(itr.first, pending_before, itr.second);
+	pending_before.reset();
+}
+
+void xs::data::internal::record(
+	const std::string& name,
+	const std::optional<registry_value>& before,
+	const std::optional<registry_value>& after)
+{
+	auto same = [](const std::optional<registry_value>& a, const std::optional<registry_value>& b) {
+		if (a.has_value() != b.has_value())
+			return false;
+		return !a || (a->data_type == b->data_type && a->value == b->value);
+	};
+
+	if (same(before, after))
+		return;
+
+	// A new change drops everything that could be redone
+	const bool undone = history_position < history.size();
+	history.erase(history.begin() + history_position, history.end());
+
+	const double now = ImGui::GetTime();
+	if (!undone && !history.empty())
+	{
+		auto& last = history.back();
+		if (last.name == name && last.after && after && now - last.time < c_coalesce_seconds)
+		{
+			last.after = after;
+			last.time = now;
+			if (same(last.before, last.after))
+				history.pop_back();
+			history_position = history.size();
+			return;
+		}
+	}
+
+	history.push_back({ name, before, after, now });
+	while (history.size() > c_max_history)
+		history.pop_front();
+	history_position = history.size();
+}
 
-	size_t idx = history.size() - 1 - history_stack_pointer;
-	if (idx < history.size() && idx >= 0) {
-		regsitry_type& r = history[idx];
-		reg = r;
+void xs::data::internal::apply(const std::string& name, const std::optional<registry_value>& value)
+{
+	if (value)
+	{
+		auto [itr, inserted] = reg.try_emplace(name);
+		itr->second = *value;
+		if (inserted)
+			generation++;
+		edited[value->data_type] = true;
+	}
+	else
+	{
+		auto itr = reg.find(name);
+		if (itr != reg.end())
+		{
+			edited[itr->second.data_type] = true;
+			reg.erase(itr);
+			generation++;
+		}
 	}
 }
 
+void xs::data::internal::undo()
+{
+	if (history_position == 0)
+		return;
+
+	history_position--;
+	const auto& c = history[history_position];
+	apply(c.name, c.before);
+}
+
+void xs::data::internal::redo()
+{
+	if (history_position == history.size())
+		return;
+
+	const auto& c = history[history_position];
+	apply(c.name, c.after);
+	// Don't fold the next edit into a change that was just redone
+	history[history_position].time = -c_coalesce_seconds;
+	history_position++;
+}
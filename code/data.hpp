@@ -14,6 +14,9 @@ namespace xs::data
 		user		= 6,
 	};
 
+	/// Interned name of a data value, resolved once and then read by index
+	using key = uint32_t;
+
 	void initialize();
 	void shutdown();
 	void inspect();
@@ -24,6 +27,14 @@ namespace xs::data
 	bool get_bool(const std::string& name, type type);
 	std::string get_string(const std::string& name, type type);
 
+	/// Get the key for a name (the same name always gives the same key, even across shutdown)
+	key intern(const std::string& name);
+
+	double get_number(key k, type type);
+	uint32_t get_color(key k, type type);
+	bool get_bool(key k, type type);
+	std::string get_string(key k, type type);
+
 	void set_number(const std::string& name, double value, type tp);
 	void set_color(const std::string& name, uint32_t value, type tp);
 	void set_bool(const std::string& name, bool value, type tp);
@@ -31,4 +42,15 @@ namespace xs::data
 
 	void save();
 	void save_of_type(type type);
+
+	/// Save without waiting for the file: the values are copied now and written on a worker
+	/// thread, to a temporary file that then replaces the old one. Saving a type that is
+	/// still being written only writes it once more, with the latest values.
+	void save_async(type type);
+
+	/// Whether background saves are still queued or being written
+	bool saving();
+
+	/// Block until all background saves are written
+	void flush_saves();
 }
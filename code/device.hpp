@@ -13,6 +13,15 @@ namespace xs::device
 	int get_height();
     void set_window_size(int w, int h);
 	double hdpi_scaling();
+
+	/// Make the graphics context current on the calling thread
+	void acquire_context();
+
+	/// Let go of the graphics context on the calling thread, so another thread can acquire it
+	void release_context();
+
+	/// Swap right away (0), on vsync (1) or on vsync unless late (-1). False when not supported.
+	bool set_swap_interval(int interval);
     
 	enum platform 
 	{
@@ -1,11 +1,18 @@
 #include "fileio.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <map>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "log.hpp"
+#include "profiler.hpp"
 #include "tools.hpp"
 #include "packager.hpp"
 #include "xs.hpp"
@@ -15,6 +22,12 @@
 #include <filesystem>
 #endif
 
+#if defined(PLATFORM_PC) && defined(_WIN32)
+#include <io.h>
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_APPLE) || defined(PLATFORM_MAC)
+#include <unistd.h>
+#endif
+
 namespace fs = std::filesystem;
 
 using namespace std;
@@ -25,6 +38,28 @@ namespace xs::fileio::internal
 	// Package data - loaded once on startup (will be populated later)
 	static packager::package loaded_package;
 	static unordered_map<std::string, const packager::package_entry*> content_map;
+
+	// Path lookups are cached, since the same paths get resolved over and over.
+	// Loader threads use these too, so they are guarded by a mutex.
+	struct resolved_path
+	{
+		string filename;
+		string path;
+		const packager::package_entry* entry = nullptr;
+	};
+	mutex cache_mutex;
+	unordered_map<string, string> path_cache;		// Wildcard form to full path
+	unordered_set<string> missing_cache;			// Full paths known not to exist
+	deque<resolved_path> resolved;					// Indexed by path_handle
+	unordered_map<string, int> resolved_ids;
+
+	string expand_wildcards(const string& filename);
+	void clear_cache();		// Needs cache_mutex
+	const packager::package_entry* find_entry(const string& filename);
+	bool exists_on_disk(const string& path);
+	bool sync_to_disk(FILE* file);
+	vector<std::byte> read_binary(const string& filename, const string& path, const packager::package_entry* entry);
+	string read_text(const string& filename, const string& path, const packager::package_entry* entry);
 }
 
 using namespace xs;
@@ -55,6 +90,7 @@ bool xs::fileio::load_package(const std::string& package_path)
 		content_map[entry.relative_path] = &entry;
 		log::info("Entry loaded: {}", entry.relative_path);
 	}
+	invalidate_cache();
 
 	return true;
 }
@@ -62,70 +98,36 @@ bool xs::fileio::load_package(const std::string& package_path)
 std::vector<std::byte> fileio::read_binary_file(const string& filename)
 {
 	// Check if file is in loaded package first (using wildcard path)
-	auto it = content_map.find(filename);
-	if (it != content_map.end())
-	{
-		const packager::package_entry* entry = it->second;
-		return packager::decompress_entry(*entry);
-	}
+	auto entry = find_entry(filename);
+	if (entry)
+		return read_binary(filename, {}, entry);
 
 	// Not in package, try reading from disk (expand wildcards)
-	const auto path = get_path(filename);
-	ifstream file(path, ios::binary | ios::ate);
-	if (!file.is_open())
-	{
-		log::error("File {} with full path {} was not found!", filename, path);
-		return {};
-	}
-
-	const streamsize size = file.tellg();
-	file.seekg(0, ios::beg);
-	std::vector<std::byte> buffer(size);
-	if (file.read((char*)buffer.data(), size))
-		return buffer;
-
-	return {};
+	return read_binary(filename, get_path(filename), nullptr);
 }
 
 string fileio::read_text_file(const string& filename)
 {
 	// Check if file is in loaded package first (using wildcard path)
-	auto it = content_map.find(filename);
-	if (it != content_map.end())
-	{
-		const packager::package_entry* entry = it->second;
-		std::vector<std::byte> data = packager::decompress_entry(*entry);
-
-		// Convert to string
-		return string(reinterpret_cast<const char*>(data.data()), data.size());
-	}
+	auto entry = find_entry(filename);
+	if (entry)
+		return read_text(filename, {}, entry);
 
 	// Not in package, try reading from disk (expand wildcards)
-	const auto path = get_path(filename);
-	ifstream file(path);
-	if (!file.is_open())
-	{
-		log::error("File {} with full path {} was not found!", filename, path);
-		return string();
-	}
-
-	file.seekg(0, ios::end);
-	const size_t size = file.tellg();
-	string buffer(size, '\0');
-	file.seekg(0);
-	file.read(&buffer[0], size);
-	return buffer;
+	return read_text(filename, get_path(filename), nullptr);
 }
 
 bool fileio::write_binary_file(const std::vector<std::byte>& data, const string& filename)
 {
+	XS_MEMORY_TAG(fileio);
 	auto fullpath = fileio::get_path(filename);
 	ofstream ofs;
-	ofs.open(fullpath);
+	ofs.open(fullpath, ios::binary);
 	if (ofs.is_open())
 	{
 		ofs.write((char*)&data[0], data.size() * sizeof(char));;
 		ofs.close();
+		forget_missing(fullpath);
 		return true;
 	}
 	return false;
@@ -133,6 +135,7 @@ bool fileio::write_binary_file(const std::vector<std::byte>& data, const string&
 
 bool fileio::write_text_file(const string& text, const string& filename)
 {
+	XS_MEMORY_TAG(fileio);
 	auto fullpath = fileio::get_path(filename);
 	ofstream ofs;
 	ofs.open(fullpath);
@@ -140,26 +143,80 @@ bool fileio::write_text_file(const string& text, const string& filename)
 	{
 		ofs << text;
 		ofs.close();
+		forget_missing(fullpath);
 		return true;
 	}
 	return false;
 }
 
+bool fileio::replace_file(const std::vector<std::byte>& data, const string& filename)
+{
+	XS_MEMORY_TAG(fileio);
+	const auto fullpath = fileio::get_path(filename);
+	const auto temp_path = fullpath + ".tmp";
+
+	FILE* file = fopen(temp_path.c_str(), "wb");
+	if (!file)
+	{
+		log::error("Could not open '{}' for writing.", temp_path);
+		return false;
+	}
+
+	// The bytes have to be on the disk before the rename, or a power loss can leave an empty file
+	bool ok = data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size();
+	ok = fflush(file) == 0 && ok;
+	ok = ok && sync_to_disk(file);
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+	{
+		log::error("Could not write '{}'.", temp_path);
+		remove(temp_path.c_str());
+		return false;
+	}
+
+#if defined(PLATFORM_PC) || defined(PLATFORM_MAC)
+	std::error_code ec;
+	fs::rename(temp_path, fullpath, ec);
+	if (ec)
+	{
+		log::error("Could not replace '{}': {}", fullpath, ec.message());
+		fs::remove(temp_path, ec);
+		return false;
+	}
+#else
+	if (rename(temp_path.c_str(), fullpath.c_str()) != 0)
+	{
+		log::error("Could not replace '{}'.", fullpath);
+		remove(temp_path.c_str());
+		return false;
+	}
+#endif
+
+	forget_missing(fullpath);
+	return true;
+}
+
 void fileio::add_wildcard(const string& wildcard, const string& value)
 {
+	// Loader threads expand wildcards while this runs
+	lock_guard<mutex> lock(cache_mutex);
 	wildcards[wildcard] = value;
+	clear_cache();
 }
 
 string fileio::get_path(const string& filename)
 {
-	string full_path = filename;
+	// Plain paths have nothing to expand
+	if (filename.find('[') == string::npos)
+		return filename;
 
-	for (const auto& p : wildcards)
-	{
-		if (full_path.find(p.first) != string::npos)
-			full_path = tools::string_replace(full_path, p.first, p.second);
-	}
+	lock_guard<mutex> lock(cache_mutex);
+	auto it = path_cache.find(filename);
+	if (it != path_cache.end())
+		return it->second;
 
+	auto full_path = expand_wildcards(filename);
+	path_cache.emplace(filename, full_path);
 	return full_path;
 }
 
@@ -174,18 +231,12 @@ std::string xs::fileio::absolute(const std::string& path)
 
 bool fileio::exists(const string& filename)
 {
-	// Expand wildcards
-	const auto path = get_path(filename);
-
 	// Check if the file is stored in the package
-	if(content_map.find(filename) != content_map.end())
+	if (find_entry(filename))
 		return true;
 
 	// Check if the file exists
-	ifstream f(path.c_str());
-    auto good = f.good();
-	f.close();
-	return good;
+	return exists_on_disk(get_path(filename));
 }
 
 #if (defined(PLATFORM_PC) || defined(PLATFORM_MAC))
@@ -213,5 +264,385 @@ uint64_t fileio::last_write(const string& filename) { return 0; }
 
 bool xs::fileio::has_wildcard(const string& wildcard)
 {
+	lock_guard<mutex> lock(cache_mutex);
 	return internal::wildcards.find(wildcard) != internal::wildcards.end();
 }
+
+void xs::fileio::invalidate_cache()
+{
+	lock_guard<mutex> lock(cache_mutex);
+	clear_cache();
+}
+
+void xs::fileio::internal::clear_cache()
+{
+	path_cache.clear();
+	missing_cache.clear();
+
+	// Handles stay valid, but what they point to might have changed
+	for (auto& r : resolved)
+	{
+		r.path = expand_wildcards(r.filename);
+		r.entry = find_entry(r.filename);
+	}
+}
+
+fileio::path_handle xs::fileio::resolve(const string& filename)
+{
+	lock_guard<mutex> lock(cache_mutex);
+	auto it = resolved_ids.find(filename);
+	if (it != resolved_ids.end())
+		return { it->second };
+
+	const int id = static_cast<int>(resolved.size());
+	resolved.push_back({ filename, expand_wildcards(filename), find_entry(filename) });
+	resolved_ids[filename] = id;
+	return { id };
+}
+
+string xs::fileio::get_path(path_handle handle)
+{
+	lock_guard<mutex> lock(cache_mutex);
+	if (handle.id < 0 || handle.id >= static_cast<int>(resolved.size()))
+		return {};
+	return resolved[handle.id].path;
+}
+
+bool xs::fileio::exists(path_handle handle)
+{
+	resolved_path r;
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		if (handle.id < 0 || handle.id >= static_cast<int>(resolved.size()))
+			return false;
+		r = resolved[handle.id];
+	}
+
+	if (r.entry)
+		return true;
+	return exists_on_disk(r.path);
+}
+
+std::vector<std::byte> xs::fileio::read_binary_file(path_handle handle)
+{
+	resolved_path r;
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		if (handle.id < 0 || handle.id >= static_cast<int>(resolved.size()))
+			return {};
+		r = resolved[handle.id];
+	}
+	return read_binary(r.filename, r.path, r.entry);
+}
+
+string xs::fileio::read_text_file(path_handle handle)
+{
+	resolved_path r;
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		if (handle.id < 0 || handle.id >= static_cast<int>(resolved.size()))
+			return {};
+		r = resolved[handle.id];
+	}
+	return read_text(r.filename, r.path, r.entry);
+}
+
+string xs::fileio::internal::expand_wildcards(const string& filename)
+{
+	string full_path = filename;
+
+	for (const auto& p : wildcards)
+	{
+		if (full_path.find(p.first) != string::npos)
+			full_path = tools::string_replace(full_path, p.first, p.second);
+	}
+
+	return full_path;
+}
+
+const packager::package_entry* xs::fileio::internal::find_entry(const string& filename)
+{
+	if (content_map.empty())
+		return nullptr;
+	auto it = content_map.find(filename);
+	return it != content_map.end() ? it->second : nullptr;
+}
+
+bool xs::fileio::internal::exists_on_disk(const string& path)
+{
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		if (missing_cache.count(path))
+			return false;
+	}
+
+#if defined(PLATFORM_PC) || defined(PLATFORM_MAC)
+	std::error_code ec;
+	const bool found = fs::exists(fs::status(path, ec));
+#else
+	ifstream f(path.c_str());
+	const bool found = f.good();
+#endif
+
+	// Only misses are cached, a file that is there is cheap to check again
+	if (!found)
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		missing_cache.insert(path);
+	}
+	return found;
+}
+
+void fileio::forget_missing(const string& path)
+{
+	lock_guard<mutex> lock(cache_mutex);
+	missing_cache.erase(path);
+}
+
+bool xs::fileio::internal::sync_to_disk(FILE* file)
+{
+#if defined(PLATFORM_PC) && defined(_WIN32)
+	return _commit(_fileno(file)) == 0;
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_APPLE) || defined(PLATFORM_MAC)
+	return fsync(fileno(file)) == 0;
+#else
+	return true;
+#endif
+}
+
+vector<std::byte> xs::fileio::internal::read_binary(
+	const string& filename,
+	const string& path,
+	const packager::package_entry* entry)
+{
+	XS_MEMORY_TAG(fileio);
+	if (entry)
+		return packager::decompress_entry(*entry);
+
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file.is_open())
+	{
+		log::error("File {} with full path {} was not found!", filename, path);
+		return {};
+	}
+
+	const streamsize size = file.tellg();
+	file.seekg(0, ios::beg);
+	std::vector<std::byte> buffer(size);
+	if (file.read((char*)buffer.data(), size))
+		return buffer;
+
+	return {};
+}
+
+string xs::fileio::internal::read_text(
+	const string& filename,
+	const string& path,
+	const packager::package_entry* entry)
+{
+	XS_MEMORY_TAG(fileio);
+	if (entry)
+	{
+		std::vector<std::byte> data = packager::decompress_entry(*entry);
+
+		// Convert to string
+		return string(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		log::error("File {} with full path {} was not found!", filename, path);
+		return string();
+	}
+
+	file.seekg(0, ios::end);
+	const size_t size = file.tellg();
+	string buffer(size, '\0');
+	file.seekg(0);
+	file.read(&buffer[0], size);
+	return buffer;
+}
+
+struct xs::fileio::stream::state
+{
+	enum class source { disk, memory, inflate };
+
+	source from = source::disk;
+	ifstream file;
+	const packager::package_entry* entry = nullptr;
+	mz_stream z = {};
+	uint64_t position = 0;
+	uint64_t length = 0;
+
+	bool start_inflate()
+	{
+		z = {};
+		z.next_in = reinterpret_cast<const unsigned char*>(entry->data.data());
+		z.avail_in = static_cast<unsigned int>(entry->data.size());
+		position = 0;
+		return mz_inflateInit(&z) == MZ_OK;
+	}
+
+	size_t inflate_into(std::byte* data, size_t size)
+	{
+		z.next_out = reinterpret_cast<unsigned char*>(data);
+		z.avail_out = static_cast<unsigned int>(size);
+		while (z.avail_out > 0)
+		{
+			const int result = mz_inflate(&z, MZ_NO_FLUSH);
+			if (result == MZ_STREAM_END)
+				break;
+			if (result != MZ_OK)
+			{
+				log::error("Failed to decompress entry: {}", entry->relative_path);
+				break;
+			}
+		}
+		return size - z.avail_out;
+	}
+
+	~state()
+	{
+		if (from == source::inflate)
+			mz_inflateEnd(&z);
+	}
+};
+
+xs::fileio::stream::stream() = default;
+xs::fileio::stream::stream(stream&& other) noexcept = default;
+xs::fileio::stream& xs::fileio::stream::operator=(stream&& other) noexcept = default;
+xs::fileio::stream::~stream() = default;
+
+fileio::stream xs::fileio::open_stream(const string& filename)
+{
+	XS_MEMORY_TAG(fileio);
+	stream s;
+	auto st = make_unique<stream::state>();
+
+	if (auto entry = find_entry(filename))
+	{
+		st->entry = entry;
+		st->length = entry->uncompressed_size;
+		if (entry->is_compressed)
+		{
+			st->from = stream::state::source::inflate;
+			if (!st->start_inflate())
+			{
+				log::error("Failed to start decompressing entry: {}", filename);
+				return s;
+			}
+		}
+		else
+		{
+			st->from = stream::state::source::memory;
+			st->length = entry->data.size();
+		}
+	}
+	else
+	{
+		const auto path = get_path(filename);
+		st->file.open(path, ios::binary | ios::ate);
+		if (!st->file.is_open())
+		{
+			log::error("File {} with full path {} was not found!", filename, path);
+			return s;
+		}
+		st->length = static_cast<uint64_t>(st->file.tellg());
+		st->file.seekg(0, ios::beg);
+	}
+
+	s.impl = std::move(st);
+	return s;
+}
+
+size_t xs::fileio::stream::read(std::byte* data, size_t size)
+{
+	if (!impl)
+		return 0;
+
+	auto& st = *impl;
+	size = static_cast<size_t>(std::min<uint64_t>(size, st.length - st.position));
+	if (size == 0)
+		return 0;
+
+	size_t count = 0;
+	switch (st.from)
+	{
+	case state::source::disk:
+		st.file.read(reinterpret_cast<char*>(data), static_cast<streamsize>(size));
+		count = static_cast<size_t>(st.file.gcount());
+		break;
+	case state::source::memory:
+		memcpy(data, st.entry->data.data() + st.position, size);
+		count = size;
+		break;
+	case state::source::inflate:
+		count = st.inflate_into(data, size);
+		break;
+	}
+
+	st.position += count;
+	return count;
+}
+
+bool xs::fileio::stream::seek(uint64_t position)
+{
+	if (!impl || position > impl->length)
+		return false;
+
+	auto& st = *impl;
+	switch (st.from)
+	{
+	case state::source::disk:
+		st.file.clear();
+		st.file.seekg(static_cast<streamoff>(position), ios::beg);
+		st.position = position;
+		return static_cast<bool>(st.file);
+	case state::source::memory:
+		st.position = position;
+		return true;
+	case state::source::inflate:
+	{
+		// Deflate has no random access, restart and skip ahead
+		if (position < st.position)
+		{
+			mz_inflateEnd(&st.z);
+			if (!st.start_inflate())
+				return false;
+		}
+
+		std::byte skip[4096];
+		while (st.position < position)
+		{
+			const size_t chunk = static_cast<size_t>(std::min<uint64_t>(sizeof(skip), position - st.position));
+			const size_t count = st.inflate_into(skip, chunk);
+			st.position += count;
+			if (count < chunk)
+				return false;
+		}
+		return true;
+	}
+	}
+	return false;
+}
+
+uint64_t xs::fileio::stream::tell() const
+{
+	return impl ? impl->position : 0;
+}
+
+uint64_t xs::fileio::stream::size() const
+{
+	return impl ? impl->length : 0;
+}
+
+bool xs::fileio::stream::eof() const
+{
+	return !impl || impl->position >= impl->length;
+}
+
+bool xs::fileio::stream::is_open() const
+{
+	return impl != nullptr;
+}
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,10 @@ namespace xs::fileio
 	std::string read_text_file(const std::string& filename);
 	bool write_binary_file(const std::vector<std::byte>& data, const std::string& filename);
 	bool write_text_file(const std::string& text, const std::string& filename);
+
+	// Write to a temporary file, flush it to disk and rename it over filename,
+	// so a crash or power loss leaves either the old file or the new one
+	bool replace_file(const std::vector<std::byte>& data, const std::string& filename);
 	void add_wildcard(const std::string& wildcard, const std::string& value);
 	std::string get_path(const std::string& filename);
 	std::string absolute(const std::string& path);
@@ -22,4 +27,57 @@ namespace xs::fileio
 
 	// Query if a wildcard is defined without modifying the state
 	bool has_wildcard(const std::string& wildcard);
+
+	// Forget cached path lookups (call on hot reload, files might have been added)
+	void invalidate_cache();
+
+	// Forget that a full path was missing, after writing it without fileio
+	void forget_missing(const std::string& path);
+
+	// A path resolved once up front, for files that are accessed often
+	struct path_handle
+	{
+		int id = -1;
+		bool valid() const { return id >= 0; }
+	};
+
+	// Resolve a path into a handle. Handles stay valid for the whole run.
+	path_handle resolve(const std::string& filename);
+	std::string get_path(path_handle handle);
+	bool exists(path_handle handle);
+	std::vector<std::byte> read_binary_file(path_handle handle);
+	std::string read_text_file(path_handle handle);
+
+	// Reads a file a chunk at a time, so it never has to be fully in memory.
+	// Works the same for loose files and package entries (compressed entries
+	// are decompressed as they are read).
+	class stream
+	{
+	public:
+		stream();
+		stream(stream&& other) noexcept;
+		stream& operator=(stream&& other) noexcept;
+		~stream();
+
+		// Read up to size bytes into data, returns the number of bytes read
+		std::size_t read(std::byte* data, std::size_t size);
+
+		// Move to an absolute position. Seeking backwards in a compressed
+		// entry restarts decompression, so prefer reading forward.
+		bool seek(uint64_t position);
+
+		uint64_t tell() const;
+		uint64_t size() const;
+		bool eof() const;
+		bool is_open() const;
+
+		struct state;
+
+	private:
+		friend stream open_stream(const std::string& filename);
+		std::unique_ptr<state> impl;
+	};
+
+	// Open a file for streaming. Check is_open() on the result.
+	stream open_stream(const std::string& filename);
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <string>
 
 namespace xs::input
 {
@@ -6,6 +8,31 @@ namespace xs::input
 	void shutdown();
 	void update(double dt);
 
+	/// <summary>
+	/// Writes the input state and dt of every frame to a file, until shutdown.
+	/// The seed is stored with it, to seed the scripts the same way on replay.
+	/// </summary>
+	/// <returns>false if the file could not be opened.</returns>
+	bool start_recording(const std::string& path, uint32_t seed);
+
+	/// <summary>
+	/// Feeds a recording back through the input API instead of reading the devices.
+	/// Can be started before initialize, no window is needed.
+	/// </summary>
+	/// <param name="seed">[Out] The seed the recording was made with.</param>
+	/// <returns>false if the file could not be read.</returns>
+	bool start_replay(const std::string& path, uint32_t& seed);
+
+	/// <summary>
+	/// Returns whether a replay is running and has frames left.
+	/// </summary>
+	bool replaying();
+
+	/// <summary>
+	/// Gets the dt the next replayed frame was recorded with, to update the game with.
+	/// </summary>
+	double replay_dt();
+
 	/// <summary>
 	/// An enum listing all possible gamepad buttons with digital input values.
 	/// This is the same numbering as in GLFW input, so a GLFW-based implementation can use it directly without any further mapping.
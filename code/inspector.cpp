@@ -348,7 +348,7 @@ void xs::inspector::render(double dt)
 
 		// Save that we've initialized the layout
 		data::set_bool("EditorDockingInitialized", true, data::type::user);
-		data::save_of_type(data::type::user);
+		data::save_async(data::type::user);
 
 		ImGui::DockBuilderRemoveNode(dockspace_id);
 		ImGui::DockBuilderAddNode(dockspace_id, ImGuiDockNodeFlags_DockSpace);
@@ -460,6 +460,7 @@ static void xs::inspector::render_top_bar()
             ImGui::SameLine();
             if (colored_button(ICON_FI_SYNC_ALT, get_color(color_id::Orange), "Reload game scripts (F5)") || xs::input::get_key_once(xs::input::KEY_F5))
             {
+                 fileio::invalidate_cache();
                  script::shutdown();
                  script::configure();
                  script::initialize();
@@ -499,7 +500,7 @@ static void xs::inspector::render_top_bar()
         {
             always_on_top = device::toggle_on_top();
             data::set_bool("always_on_top", always_on_top, data::type::user);
-            data::save_of_type(data::type::user);
+            data::save_async(data::type::user);
         }
 
         // Zoom dropdown
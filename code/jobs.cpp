@@ -0,0 +1,358 @@
+#include "jobs.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include "log.hpp"
+#include "profiler.hpp"
+
+using namespace std;
+
+namespace xs::jobs::internal
+{
+	// Jobs of one worker. The owner pushes and pops at the back, idle workers steal from the front,
+	// so the owner works on what is hot in its cache and thieves take the oldest work.
+	struct worker_queue
+	{
+		mutex lock;
+		deque<job> jobs;
+	};
+
+	vector<thread> workers;
+	vector<unique_ptr<worker_queue>> queues;
+	deque<job> main_queue;				// Jobs that only the main thread runs
+	mutex main_mutex;
+	mutex sleep_mutex;
+	condition_variable wake_cv;
+	atomic<int> queued = 0;				// Jobs in the worker queues
+	atomic<unsigned int> next_queue = 0;	// Round robin for jobs from outside the workers
+	atomic<bool> running = false;
+	thread::id main_thread;
+	thread_local int worker_index = -1;
+
+	// Profiler ids of the job names this thread submitted. Names are string literals, so the
+	// pointer identifies the call site and the profiler's lock is only taken the first time.
+	thread_local vector<pair<const char*, uint32_t>> name_ids;
+
+	uint32_t name_id(const char* name);
+	void worker_loop(int index);
+	void add(job_fn fn, counter* done, affinity where, uint32_t profile_id);
+	void push(job&& j);
+	bool pop(int index, job& j);
+	bool steal(int thief, job& j);
+	bool run_one();
+	void run(job& j);
+	void finish(counter* c);
+}
+
+using namespace xs;
+using namespace xs::jobs::internal;
+
+void xs::jobs::initialize()
+{
+	if (running)
+		return;
+
+	main_thread = this_thread::get_id();
+
+	// Leave one core for the main thread
+	const unsigned int cores = thread::hardware_concurrency();
+	const unsigned int count = std::max(1u, cores > 1 ? cores - 1 : 1u);
+
+	for (unsigned int i = 0; i < count; i++)
+		queues.push_back(make_unique<worker_queue>());
+
+	running = true;
+	for (unsigned int i = 0; i < count; i++)
+		workers.emplace_back(worker_loop, (int)i);
+
+	log::info("Job system started with {} workers", count);
+}
+
+void xs::jobs::shutdown()
+{
+	if (!running)
+		return;
+
+	// Workers drain the queues before they stop, so no counter is left waiting
+	while (queued > 0)
+		run_one();
+
+	{
+		lock_guard<mutex> lock(sleep_mutex);
+		running = false;
+	}
+	wake_cv.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+	queues.clear();
+
+	// Main thread jobs that never got their update
+	update();
+}
+
+void xs::jobs::update()
+{
+	XS_PROFILE_SECTION("xs::jobs::update");
+
+	// Only what is queued now, jobs queued by these wait for the next frame
+	deque<job> ready;
+	{
+		lock_guard<mutex> lock(main_mutex);
+		ready.swap(main_queue);
+	}
+
+	for (auto& j : ready)
+		run(j);
+}
+
+void xs::jobs::submit(job_fn fn, counter* done, affinity where, const char* name)
+{
+	add(std::move(fn), done, where, name_id(name));
+}
+
+void xs::jobs::submit_after(counter& dependency, job_fn fn, counter* done, affinity where, const char* name)
+{
+	if (done)
+		done->count.fetch_add(1, memory_order_relaxed);
+
+	job j;
+	j.fn = std::move(fn);
+	j.done = done;
+	j.where = where;
+	j.profile_id = name_id(name);
+
+	{
+		// Checked under the lock that finish() takes, so the job is either kept or pushed here
+		lock_guard<mutex> lock(dependency.mutex);
+		if (dependency.pending() > 0)
+		{
+			dependency.continuations.push_back(std::move(j));
+			return;
+		}
+	}
+	push(std::move(j));
+}
+
+void xs::jobs::wait(counter& c)
+{
+	int idle = 0;
+	while (c.pending() > 0)
+	{
+		if (run_one())
+		{
+			idle = 0;
+			continue;
+		}
+
+		// Nothing to help with, the last jobs are running elsewhere
+		if (++idle < 64)
+			this_thread::yield();
+		else
+			this_thread::sleep_for(chrono::microseconds(100));
+	}
+
+	// The last job counts down under the lock, so once it is free the counter can go away
+	lock_guard<mutex> lock(c.mutex);
+}
+
+void xs::jobs::parallel_for(int begin, int end, const function<void(int)>& body, int grain, const char* name)
+{
+	const int count = end - begin;
+	if (count <= 0)
+		return;
+
+	// A few batches per worker evens out batches that take longer than others
+	const int workers = std::max(worker_count(), 1);
+	const int batches = std::clamp(count / std::max(grain, 1), 1, workers * 4);
+	const int size = (count + batches - 1) / batches;
+
+	const uint32_t profile_id = name_id(name);
+	counter done;
+	for (int first = begin; first < end; first += size)
+	{
+		const int last = std::min(first + size, end);
+		add([&body, first, last] {
+			for (int i = first; i < last; i++)
+				body(i);
+		}, &done, affinity::any, profile_id);
+	}
+	wait(done);
+}
+
+int xs::jobs::worker_count()
+{
+	return static_cast<int>(workers.size());
+}
+
+bool xs::jobs::is_main_thread()
+{
+	return this_thread::get_id() == main_thread;
+}
+
+void xs::jobs::internal::worker_loop(int index)
+{
+	worker_index = index;
+	profiler::set_thread_name("Job worker " + std::to_string(index));
+	while (true)
+	{
+		job j;
+		if (pop(index, j) || steal(index, j))
+		{
+			run(j);
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleep_mutex);
+		wake_cv.wait(lock, [] { return queued > 0 || !running; });
+		if (!running && queued == 0)
+			return;
+	}
+}
+
+uint32_t xs::jobs::internal::name_id(const char* name)
+{
+	for (const auto& n : name_ids)
+		if (n.first == name)
+			return n.second;
+
+	const uint32_t id = profiler::get_id(name);
+	name_ids.emplace_back(name, id);
+	return id;
+}
+
+void xs::jobs::internal::add(job_fn fn, counter* done, affinity where, uint32_t profile_id)
+{
+	if (done)
+		done->count.fetch_add(1, memory_order_relaxed);
+
+	job j;
+	j.fn = std::move(fn);
+	j.done = done;
+	j.where = where;
+	j.profile_id = profile_id;
+	push(std::move(j));
+}
+
+void xs::jobs::internal::push(job&& j)
+{
+	// Without workers everything runs right here, like before there were threads
+	if (!running)
+	{
+		run(j);
+		return;
+	}
+
+	if (j.where == affinity::main)
+	{
+		lock_guard<mutex> lock(main_mutex);
+		main_queue.push_back(std::move(j));
+		return;
+	}
+
+	// Workers keep their own jobs, everyone else spreads them out
+	const unsigned int index = worker_index >= 0 ?
+		(unsigned int)worker_index :
+		next_queue.fetch_add(1, memory_order_relaxed) % (unsigned int)queues.size();
+	{
+		lock_guard<mutex> lock(queues[index]->lock);
+		queues[index]->jobs.push_back(std::move(j));
+	}
+	queued++;
+
+	// Taking the lock makes sure a worker that is about to sleep sees the job
+	{
+		lock_guard<mutex> lock(sleep_mutex);
+	}
+	wake_cv.notify_one();
+}
+
+bool xs::jobs::internal::pop(int index, job& j)
+{
+	auto& q = *queues[index];
+	lock_guard<mutex> lock(q.lock);
+	if (q.jobs.empty())
+		return false;
+	j = std::move(q.jobs.back());
+	q.jobs.pop_back();
+	queued--;
+	return true;
+}
+
+bool xs::jobs::internal::steal(int thief, job& j)
+{
+	const int count = static_cast<int>(queues.size());
+	for (int i = 1; i <= count; i++)
+	{
+		auto& q = *queues[(thief + i) % count];
+		lock_guard<mutex> lock(q.lock);
+		if (q.jobs.empty())
+			continue;
+		j = std::move(q.jobs.front());
+		q.jobs.pop_front();
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+// Run one queued job the calling thread is allowed to run
+bool xs::jobs::internal::run_one()
+{
+	job j;
+	bool found = false;
+	if (is_main_thread())
+	{
+		lock_guard<mutex> lock(main_mutex);
+		if (!main_queue.empty())
+		{
+			j = std::move(main_queue.front());
+			main_queue.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found && !queues.empty())
+	{
+		if (worker_index >= 0)
+			found = pop(worker_index, j) || steal(worker_index, j);
+		else
+			found = steal(0, j);
+	}
+
+	if (found)
+		run(j);
+	return found;
+}
+
+void xs::jobs::internal::run(job& j)
+{
+	profiler::begin(j.profile_id);
+	if (j.fn)
+		j.fn();
+	profiler::end(j.profile_id);
+	finish(j.done);
+}
+
+void xs::jobs::internal::finish(counter* c)
+{
+	if (!c)
+		return;
+
+	// Counted down under the lock, so submit_after() either sees the count at zero
+	// or leaves its job for this to start
+	vector<job> ready;
+	{
+		lock_guard<mutex> lock(c->mutex);
+		if (c->count.fetch_sub(1, memory_order_acq_rel) == 1)
+			ready.swap(c->continuations);
+	}
+
+	// The last job is done, start what waited for it
+	for (auto& j : ready)
+		push(std::move(j));
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace xs::jobs
+{
+	/// Where a job may run. GL calls and anything else tied to the main thread need main.
+	enum class affinity { any, main };
+
+	using job_fn = std::function<void()>;
+
+	struct job
+	{
+		job_fn fn;
+		struct counter* done = nullptr;
+		affinity where = affinity::any;
+		uint32_t profile_id = 0;
+	};
+
+	/// Counts submitted jobs that have not finished yet. Wait on it to join them or use it
+	/// as the dependency of later jobs. Must outlive the jobs that use it.
+	struct counter
+	{
+		/// Jobs that have not finished yet
+		int pending() const { return count.load(std::memory_order_acquire); }
+
+		std::atomic<int> count{ 0 };
+		std::mutex mutex;
+		std::vector<job> continuations;	// Jobs that start when the count reaches zero
+	};
+
+	/// Start the worker threads (one per core, leaving one for the main thread)
+	void initialize();
+
+	/// Finish the queued jobs and stop the worker threads
+	void shutdown();
+
+	/// Run the jobs that wait for the main thread (called once per frame)
+	void update();
+
+	/// Queue a job. The optional counter goes up now and down when the job is done.
+	/// Without worker threads (not initialized) the job runs right away.
+	/// Names label jobs in the profiler and have to be string literals (looked up by address).
+	void submit(job_fn fn, counter* done = nullptr, affinity where = affinity::any, const char* name = "xs::jobs::job");
+
+	/// Queue a job that starts once the dependency counter reaches zero
+	void submit_after(counter& dependency, job_fn fn, counter* done = nullptr, affinity where = affinity::any, const char* name = "xs::jobs::job");
+
+	/// Block until the counter reaches zero, running other jobs in the meantime
+	void wait(counter& c);
+
+	/// Run body(i) for every i in [begin, end) on all workers, in batches of at least grain,
+	/// and return when all are done. The calling thread helps.
+	void parallel_for(int begin, int end, const std::function<void(int)>& body, int grain = 1, const char* name = "xs::jobs::parallel_for");
+
+	/// Number of worker threads, zero when not running
+	int worker_count();
+
+	/// Whether the calling thread is the main thread
+	bool is_main_thread();
+}
@@ -0,0 +1,178 @@
+#include "loader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include "jobs.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+
+using namespace std;
+
+namespace xs::loader::internal
+{
+	// Time the main thread may spend on finishing loads each frame
+	constexpr double c_budget_ms = 2.0;
+
+	struct finished_load
+	{
+		ticket id = 0;
+		finish_fn finish;
+	};
+
+	deque<finished_load> finished;		// Waiting for the main thread
+	vector<finish_fn> deferred;			// Waiting for the next update (main thread only)
+	unordered_set<ticket> unfinished;	// Submitted loads whose finish has not run (main thread only)
+	ticket next_ticket = 1;
+	mutex finished_mutex;
+	condition_variable finished_cv;
+	jobs::counter working;			// Work jobs that have not run yet
+	atomic<int> in_flight = 0;		// Submitted but not yet finished
+	atomic<bool> running = false;
+
+	bool run_one_finished();
+	void run_finish(finished_load& load);
+}
+
+using namespace xs;
+using namespace xs::loader::internal;
+
+void xs::loader::initialize()
+{
+	// The work runs on the job system, only the main thread part is kept here
+	running = true;
+}
+
+void xs::loader::shutdown()
+{
+	if (!running)
+		return;
+
+	// Work that has not started yet is skipped, what is running gets to finish
+	running = false;
+	jobs::wait(working);
+
+	lock_guard<mutex> lock(finished_mutex);
+	finished.clear();
+	deferred.clear();
+	unfinished.clear();
+	in_flight = 0;
+}
+
+void xs::loader::update()
+{
+	XS_PROFILE_SECTION("xs::loader::update");
+
+	// Deferred work can defer more, which then waits for the next update
+	auto ready = std::move(deferred);
+	deferred.clear();
+	for (auto& fn : ready)
+		fn();
+
+	const auto start = chrono::steady_clock::now();
+
+	// Always finish at least one load per frame, so progress is made
+	// even when a single upload takes longer than the budget
+	while (run_one_finished())
+	{
+		const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		if (elapsed.count() > c_budget_ms)
+			break;
+	}
+}
+
+xs::loader::ticket xs::loader::submit(work_fn work, finish_fn finish)
+{
+	const ticket id = next_ticket++;
+	in_flight++;
+
+	// Without worker threads (not initialized or shut down) just do it all here
+	if (!running || jobs::worker_count() == 0)
+	{
+		if (work)
+			work();
+		if (finish)
+			finish();
+		in_flight--;
+		return id;
+	}
+
+	unfinished.insert(id);
+	jobs::submit([id, work = std::move(work), finish = std::move(finish)]() mutable {
+		if (work && running)
+			work();
+
+		lock_guard<mutex> lock(finished_mutex);
+		finished.push_back({ id, std::move(finish) });
+		finished_cv.notify_all();
+	}, &working, jobs::affinity::any, "xs::loader::work");
+	return id;
+}
+
+void xs::loader::wait(ticket t)
+{
+	if (!unfinished.count(t))
+		return;
+
+	// Don't help with other jobs here, they could be main thread work that must not run
+	// inside a foreign call. The workers get to this load on their own.
+	finished_load load;
+	{
+		unique_lock<mutex> lock(finished_mutex);
+		auto it = finished.end();
+		finished_cv.wait(lock, [&] {
+			it = find_if(finished.begin(), finished.end(), [t](const finished_load& l) { return l.id == t; });
+			return it != finished.end();
+		});
+		load = std::move(*it);
+		finished.erase(it);
+	}
+	run_finish(load);
+}
+
+void xs::loader::defer(finish_fn fn)
+{
+	deferred.push_back(std::move(fn));
+}
+
+void xs::loader::flush()
+{
+	while (pending() > 0)
+	{
+		// Help with the work, then finish it (which may queue more)
+		jobs::wait(working);
+		while (run_one_finished());
+	}
+}
+
+int xs::loader::pending()
+{
+	return in_flight;
+}
+
+bool xs::loader::internal::run_one_finished()
+{
+	finished_load load;
+	{
+		lock_guard<mutex> lock(finished_mutex);
+		if (finished.empty())
+			return false;
+		load = std::move(finished.front());
+		finished.pop_front();
+	}
+
+	run_finish(load);
+	return true;
+}
+
+void xs::loader::internal::run_finish(finished_load& load)
+{
+	unfinished.erase(load.id);
+	if (load.finish)
+		load.finish();
+	in_flight--;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace xs::loader
+{
+	/// Work that runs on a job system worker (file reading, decoding)
+	using work_fn = std::function<void()>;
+
+	/// Work that runs on the main thread once the work is done (GPU upload, callbacks)
+	using finish_fn = std::function<void()>;
+
+	/// Identifies a single load, to wait for just that one
+	using ticket = uint64_t;
+
+	/// Start taking loads (the job system has to be running for them to be threaded)
+	void initialize();
+
+	/// Skip the work that has not started yet and drop the finish work that has not run
+	void shutdown();
+
+	/// Run finished main thread work, within the per frame time budget (called once per frame)
+	void update();
+
+	/// Queue a load. The work runs on a worker thread, the finish runs on the main thread
+	/// during a later update(). Either of the two can be empty.
+	ticket submit(work_fn work, finish_fn finish);
+
+	/// Block until this load's work is done and run its finish right away. Runs no other jobs
+	/// or finish work, so it is safe inside a foreign call. Returns at once for finished loads.
+	void wait(ticket t);
+
+	/// Run this on the main thread at the start of the next update(), never from flush() or from
+	/// inside submit(). For callbacks into scripts, which can't run inside a foreign call.
+	void defer(finish_fn fn);
+
+	/// Block until all queued loads are done and run all their finish work (deferred work
+	/// still waits for update)
+	void flush();
+
+	/// Number of loads that are queued, in flight or waiting to finish
+	int pending();
+}
@@ -1,22 +1,268 @@
 #include "log.hpp"
+#include "profiler.hpp"
 #include "version.hpp"
 #include "xs.hpp"
 #include <sstream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
 
 #if defined(PLATFORM_PC) && defined(_WIN32)
 #include <windows.h>
 #endif
 
+namespace xs::log::internal
+{
+    // Messages are queued in a fixed ring that any thread can add to without taking a lock
+    // (a bounded queue with a sequence number per slot). The writer thread empties it in
+    // batches, so a burst of messages costs one write instead of one per message.
+    constexpr size_t c_ring_size = 4096;
+    constexpr auto c_writer_interval = std::chrono::milliseconds(5);
+
+    // The same message again within this time is counted instead of written
+    constexpr auto c_repeat_window = std::chrono::seconds(1);
+
+    struct ring_slot
+    {
+        std::atomic<size_t> sequence = 0;
+        std::string message;
+    };
+
+    std::array<ring_slot, c_ring_size> ring;
+    std::atomic<size_t> write_position = 0;
+    size_t read_position = 0;
+
+    // Whoever holds this is the one reader of the ring (the writer thread or a flush)
+    std::mutex writer_mutex;
+    std::thread writer;
+    std::atomic<bool> running = false;
+    FILE* file = nullptr;
+
+    std::string batch;
+    std::string last_message;
+    int repeats = 0;
+    std::chrono::steady_clock::time_point last_time;
+
+    bool push(std::string& message);
+    bool pop(std::string& message);
+    void add_to_batch(std::string& message);
+    void add_repeats();
+    void write_batch();
+    void drain();
+    void writer_loop();
+    void start_writer();
+
+    // Stops the writer thread at exit when shutdown was never called
+    struct exit_guard
+    {
+        exit_guard()
+        {
+            for (size_t i = 0; i < c_ring_size; i++)
+                ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        ~exit_guard() { xs::log::shutdown(); }
+    } guard;
+}
+
+using namespace xs::log::internal;
+
 // Common output function used by all logging configurations
-void xs::log::output_log(const std::string& message)
+void xs::log::output_log(std::string message)
+{
+    if (!running)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        add_to_batch(message);
+        write_batch();
+        return;
+    }
+
+    // When the ring is full, write out what is there and try again
+    while (!push(message))
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        drain();
+    }
+}
+
+void xs::log::shutdown()
+{
+    if (running.exchange(false) && writer.joinable())
+        writer.join();
+
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    drain();
+    add_repeats();
+    write_batch();
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void xs::log::set_file(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    drain();
+    if (file)
+        fclose(file);
+    file = path.empty() ? nullptr : fopen(path.c_str(), "w");
+    if (!path.empty() && !file)
+        std::cout << "Could not open log file " << path << "\n";
+}
+
+void xs::log::flush()
+{
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    drain();
+    add_repeats();
+    write_batch();
+}
+
+bool xs::log::internal::push(std::string& message)
+{
+    size_t position = write_position.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto& slot = ring[position & (c_ring_size - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+        if (difference == 0)
+        {
+            // The slot is free, claim it by moving the write position past it
+            if (write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.message = std::move(message);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Still holds a message from a lap ago, so the ring is full
+            return false;
+        }
+        else
+        {
+            // Another thread took this slot first
+            position = write_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool xs::log::internal::pop(std::string& message)
+{
+    auto& slot = ring[read_position & (c_ring_size - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != read_position + 1)
+        return false;
+
+    message.swap(slot.message);
+    slot.message.clear();
+    slot.sequence.store(read_position + c_ring_size, std::memory_order_release);
+    read_position++;
+    return true;
+}
+
+void xs::log::internal::add_to_batch(std::string& message)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (message == last_message && now - last_time < c_repeat_window)
+    {
+        repeats++;
+        return;
+    }
+
+    add_repeats();
+    batch += message;
+    batch += '\n';
+    last_message.swap(message);
+    last_time = now;
+}
+
+void xs::log::internal::add_repeats()
 {
+    if (repeats == 0)
+        return;
+
+    batch += XS_FORMAT("    (repeated {} more {})\n", repeats, repeats == 1 ? "time" : "times");
+    repeats = 0;
+}
+
+void xs::log::internal::write_batch()
+{
+    if (batch.empty())
+        return;
+
     // Always output to console (if available)
-    std::cout << message << "\n" << std::flush;
+    std::cout << batch << std::flush;
 
     #if defined(PLATFORM_PC) && defined(_WIN32) && defined(XS_RELEASE)
     // In Release builds without console, also output to debugger
-    OutputDebugStringA(message.c_str());
+    OutputDebugStringA(batch.c_str());
     #endif
+
+    if (file)
+    {
+        // Leave out the color codes
+        std::string plain;
+        plain.reserve(batch.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            if (batch[i] == '\033')
+            {
+                const auto end = batch.find('m', i);
+                if (end != std::string::npos)
+                {
+                    i = end;
+                    continue;
+                }
+            }
+            plain += batch[i];
+        }
+        fwrite(plain.data(), 1, plain.size(), file);
+        fflush(file);
+    }
+
+    batch.clear();
+}
+
+void xs::log::internal::drain()
+{
+    std::string message;
+    while (pop(message))
+        add_to_batch(message);
+
+    // A run of repeats is reported once the window is over
+    if (repeats > 0 && std::chrono::steady_clock::now() - last_time >= c_repeat_window)
+    {
+        add_repeats();
+        last_message.clear();
+    }
+
+    write_batch();
+}
+
+void xs::log::internal::start_writer()
+{
+    if (!running.exchange(true))
+        writer = std::thread(writer_loop);
+}
+
+void xs::log::internal::writer_loop()
+{
+    profiler::set_thread_name("Log writer");
+    while (running)
+    {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            drain();
+        }
+        std::this_thread::sleep_for(c_writer_interval);
+    }
 }
 
 // UTF-8 - Modern terminals with emoji and unicode
@@ -53,6 +299,7 @@ void xs::log::initialize()
 #endif
 
     output_log(banner.str());
+    start_writer();
 
 #ifdef TEST_LOGGING
     xs::log::info("This is an info message");
@@ -77,6 +324,7 @@ void xs::log::initialize()
     banner << "\n";
 
     output_log(banner.str());
+    start_writer();
 }
 
 #endif
@@ -27,6 +27,15 @@
 #define USE_UTF8_LOG
 #endif
 
+// Lowest level that is compiled in: 0 info, 1 warn, 2 error (Release drops info)
+#ifndef XS_LOG_MIN_LEVEL
+#ifdef XS_RELEASE
+#define XS_LOG_MIN_LEVEL 1
+#else
+#define XS_LOG_MIN_LEVEL 0
+#endif
+#endif
+
 namespace xs::log
 {
 #ifdef USE_LOG_COLOR
@@ -43,10 +52,18 @@ namespace xs::log
     constexpr const char* reset = "";
 #endif
 
+	// Start the thread that writes the messages, until then they are written right away
 	void initialize();
 
-	// Internal helper for logging to appropriate output (console or debugger)
-	void output_log(const std::string& message);
+	// Write what is queued and stop the writer thread
+	void shutdown();
+
+	// Also write the messages to this file (without colors), an empty path closes it
+	void set_file(const std::string& path);
+
+	// Internal helper for logging to appropriate output (console or debugger).
+	// Queues the message for the writer thread, repeats of a message are collapsed.
+	void output_log(std::string message);
 
 	template<typename FormatString, typename... Args>
 	void info(const FormatString& fmt, const Args&... args);
@@ -63,6 +80,7 @@ namespace xs::log
 	template<typename FormatString, typename... Args>
 	void script(const FormatString& fmt, const Args&... args);
 
+	// Write all queued messages now
 	void flush();
 }
 
@@ -79,36 +97,43 @@ namespace xs::log
 template<typename FormatString, typename ...Args>
 inline void xs::log::info(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::string("ℹ️  ") + info_color + std::vformat(format, std::make_format_args(args...)) + reset;
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 0)
+	{
+		std::string message = std::string("ℹ️  ") + info_color + std::vformat(format, std::make_format_args(args...)) + reset;
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::warn(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::string("⚠️  ") + warn_color + std::vformat(format, std::make_format_args(args...)) + reset;
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 1)
+	{
+		std::string message = std::string("⚠️  ") + warn_color + std::vformat(format, std::make_format_args(args...)) + reset;
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::error(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("⛔️  ") + error_color + std::vformat(format, std::make_format_args(args...)) + reset;
-	output_log(message);
+	output_log(std::move(message));
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::critical(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("🚨  ") + critical_color + std::vformat(format, std::make_format_args(args...)) + reset;
-	output_log(message);
+	output_log(std::move(message));
+	flush();
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::script(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("📜  ") + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	output_log(std::move(message));
 }
 
 #else
@@ -116,36 +141,43 @@ inline void xs::log::script(const FormatString& format, const Args & ...args)
 template<typename FormatString, typename ...Args>
 inline void xs::log::info(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::format("[{}info{}] ", info_color, reset) + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 0)
+	{
+		std::string message = std::format("[{}info{}] ", info_color, reset) + std::vformat(format, std::make_format_args(args...));
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::warn(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::format("[{}warn{}] ", warn_color, reset) + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 1)
+	{
+		std::string message = std::format("[{}warn{}] ", warn_color, reset) + std::vformat(format, std::make_format_args(args...));
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::error(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::format("[{}error{}] ", error_color, reset) + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	output_log(std::move(message));
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::critical(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::format("[{}error{}] ", error_color, reset) + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	output_log(std::move(message));
+	flush();
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::script(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::format("[script] ") + std::vformat(format, std::make_format_args(args...));
-	output_log(message);
+	output_log(std::move(message));
 }
 
 #endif
@@ -162,36 +194,43 @@ inline void xs::log::script(const FormatString& format, const Args & ...args)
 template<typename FormatString, typename ...Args>
 inline void xs::log::info(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::string("ℹ️  ") + info_color + fmt::format(fmt::runtime(format), args...) + reset;
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 0)
+	{
+		std::string message = std::string("ℹ️  ") + info_color + fmt::format(fmt::runtime(format), args...) + reset;
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::warn(const FormatString& format, const Args & ...args)
 {
-	std::string message = std::string("⚠️  ") + warn_color + fmt::format(fmt::runtime(format), args...) + reset;
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 1)
+	{
+		std::string message = std::string("⚠️  ") + warn_color + fmt::format(fmt::runtime(format), args...) + reset;
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::error(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("⛔️  ") + error_color + fmt::format(fmt::runtime(format), args...) + reset;
-	output_log(message);
+	output_log(std::move(message));
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::critical(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("🚨  ") + critical_color + fmt::format(fmt::runtime(format), args...) + reset;
-	output_log(message);
+	output_log(std::move(message));
+	flush();
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::script(const FormatString& format, const Args & ...args)
 {
 	std::string message = std::string("📜  ") + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	output_log(std::move(message));
 }
 
 #else
@@ -199,43 +238,46 @@ inline void xs::log::script(const FormatString& format, const Args & ...args)
 template<typename FormatString, typename ...Args>
 inline void xs::log::info(const FormatString& format, const Args & ...args)
 {
-	std::string message = fmt::format("[{}info{}] ", info_color, reset) + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 0)
+	{
+		std::string message = fmt::format("[{}info{}] ", info_color, reset) + fmt::format(fmt::runtime(format), args...);
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::warn(const FormatString& format, const Args & ...args)
 {
-	std::string message = fmt::format("[{}warn{}] ", warn_color, reset) + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	if constexpr (XS_LOG_MIN_LEVEL <= 1)
+	{
+		std::string message = fmt::format("[{}warn{}] ", warn_color, reset) + fmt::format(fmt::runtime(format), args...);
+		output_log(std::move(message));
+	}
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::error(const FormatString& format, const Args & ...args)
 {
 	std::string message = fmt::format("[{}error{}] ", error_color, reset) + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	output_log(std::move(message));
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::critical(const FormatString& format, const Args & ...args)
 {
 	std::string message = fmt::format("[{}error{}] ", error_color, reset) + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	output_log(std::move(message));
+	flush();
 }
 
 template<typename FormatString, typename ...Args>
 inline void xs::log::script(const FormatString& format, const Args & ...args)
 {
 	std::string message = fmt::format("[script] ") + fmt::format(fmt::runtime(format), args...);
-	output_log(message);
+	output_log(std::move(message));
 }
 
 #endif 
 
 #endif
 
-inline void xs::log::flush()
-{
-	std::cout.flush();
-}
@@ -0,0 +1,260 @@
+#include "mixer.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Pick the widest instruction set the build targets. There is no runtime
+// dispatch, so AVX is only used when the compiler is allowed to emit it.
+#if defined(__AVX__)
+#define XS_MIXER_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XS_MIXER_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define XS_MIXER_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace xs;
+
+void xs::mixer::mix_mono(float* out, const float* in, int frames, float gain_left, float gain_right)
+{
+	int i = 0;
+
+#if XS_MIXER_AVX
+	// 8 mono samples become 16 stereo samples
+	const __m256 gains = _mm256_setr_ps(
+		gain_left, gain_right, gain_left, gain_right,
+		gain_left, gain_right, gain_left, gain_right);
+	for (; i + 8 <= frames; i += 8)
+	{
+		const __m256 s = _mm256_loadu_ps(in + i);
+		const __m256 lo = _mm256_unpacklo_ps(s, s);		// s0 s0 s1 s1 | s4 s4 s5 s5
+		const __m256 hi = _mm256_unpackhi_ps(s, s);		// s2 s2 s3 s3 | s6 s6 s7 s7
+		const __m256 a = _mm256_permute2f128_ps(lo, hi, 0x20);	// s0 s0 s1 s1 s2 s2 s3 s3
+		const __m256 b = _mm256_permute2f128_ps(lo, hi, 0x31);	// s4 s4 s5 s5 s6 s6 s7 s7
+		float* o = out + i * 2;
+		_mm256_storeu_ps(o, _mm256_add_ps(_mm256_loadu_ps(o), _mm256_mul_ps(a, gains)));
+		_mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), _mm256_mul_ps(b, gains)));
+	}
+#elif XS_MIXER_SSE
+	// 4 mono samples become 8 stereo samples
+	const __m128 gains = _mm_setr_ps(gain_left, gain_right, gain_left, gain_right);
+	for (; i + 4 <= frames; i += 4)
+	{
+		const __m128 s = _mm_loadu_ps(in + i);
+		const __m128 a = _mm_unpacklo_ps(s, s);		// s0 s0 s1 s1
+		const __m128 b = _mm_unpackhi_ps(s, s);		// s2 s2 s3 s3
+		float* o = out + i * 2;
+		_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(a, gains)));
+		_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(b, gains)));
+	}
+#elif XS_MIXER_NEON
+	for (; i + 4 <= frames; i += 4)
+	{
+		const float32x4_t s = vld1q_f32(in + i);
+		float* o = out + i * 2;
+		// vld2/vst2 deinterleave, so left and right are handled as separate vectors
+		float32x4x2_t acc = vld2q_f32(o);
+		acc.val[0] = vmlaq_n_f32(acc.val[0], s, gain_left);
+		acc.val[1] = vmlaq_n_f32(acc.val[1], s, gain_right);
+		vst2q_f32(o, acc);
+	}
+#endif
+
+	// Scalar tail (or everything, without SIMD)
+	for (; i < frames; i++)
+	{
+		out[i * 2 + 0] += in[i] * gain_left;
+		out[i * 2 + 1] += in[i] * gain_right;
+	}
+}
+
+void xs::mixer::mix_stereo(float* out, const float* in, int frames, float gain_left, float gain_right)
+{
+	int i = 0;
+	const int samples = frames * 2;
+
+#if XS_MIXER_AVX
+	const __m256 gains = _mm256_setr_ps(
+		gain_left, gain_right, gain_left, gain_right,
+		gain_left, gain_right, gain_left, gain_right);
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m256 s = _mm256_loadu_ps(in + i);
+		_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(s, gains)));
+	}
+#elif XS_MIXER_SSE
+	const __m128 gains = _mm_setr_ps(gain_left, gain_right, gain_left, gain_right);
+	for (; i + 4 <= samples; i += 4)
+	{
+		const __m128 s = _mm_loadu_ps(in + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(s, gains)));
+	}
+#elif XS_MIXER_NEON
+	const float gains_array[4] = { gain_left, gain_right, gain_left, gain_right };
+	const float32x4_t gains = vld1q_f32(gains_array);
+	for (; i + 4 <= samples; i += 4)
+		vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), vld1q_f32(in + i), gains));
+#endif
+
+	for (; i < samples; i += 2)
+	{
+		out[i + 0] += in[i + 0] * gain_left;
+		out[i + 1] += in[i + 1] * gain_right;
+	}
+}
+
+void xs::mixer::pan_gains(float volume, float pan, float& gain_left, float& gain_right)
+{
+	pan = std::clamp(pan, -1.0f, 1.0f);
+	gain_left = volume * std::min(1.0f, 1.0f - pan);
+	gain_right = volume * std::min(1.0f, 1.0f + pan);
+}
+
+const char* xs::mixer::simd_name()
+{
+#if XS_MIXER_AVX
+	return "AVX";
+#elif XS_MIXER_SSE
+	return "SSE2";
+#elif XS_MIXER_NEON
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+namespace xs::mixer::internal
+{
+	// Zero crossings of the sinc on each side, and table entries between two crossings
+	constexpr int c_half_width = 16;
+	constexpr int c_phases = 256;
+
+	// Cutoff a little under the lower of the two Nyquist rates, to keep aliasing out
+	constexpr double c_rolloff = 0.95;
+
+	const std::vector<float>& kernel();
+}
+
+using namespace xs::mixer::internal;
+
+// Blackman windowed sinc, sampled from the center to the last zero crossing
+const std::vector<float>& xs::mixer::internal::kernel()
+{
+	static const std::vector<float> table = [] {
+		constexpr double pi = 3.14159265358979323846;
+		std::vector<float> values(c_half_width * c_phases + 2, 0.0f);
+		for (int i = 0; i <= c_half_width * c_phases; i++)
+		{
+			const double x = static_cast<double>(i) / c_phases;
+			const double sinc = i == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+			const double u = x / c_half_width;
+			const double window = 0.42 + 0.5 * std::cos(pi * u) + 0.08 * std::cos(2.0 * pi * u);
+			values[i] = static_cast<float>(sinc * window);
+		}
+		return values;
+	}();
+	return table;
+}
+
+xs::mixer::resampler::resampler(int channels, int from_rate, int to_rate)
+	: channels(channels)
+{
+	step = static_cast<double>(from_rate) / to_rate;
+	scale = std::min(1.0, static_cast<double>(to_rate) / from_rate) * c_rolloff;
+	radius = static_cast<int>(std::ceil(c_half_width / scale));
+
+	reset();
+}
+
+int xs::mixer::resampler::max_output(int input_frames) const
+{
+	return static_cast<int>(std::ceil((input_frames + 2.0 * radius) / step)) + 2;
+}
+
+void xs::mixer::resampler::reserve(int input_frames)
+{
+	history.reserve(static_cast<size_t>(input_frames + 3 * radius) * channels);
+}
+
+int xs::mixer::resampler::process(const float* in, int frames, float* out)
+{
+	history.insert(history.end(), in, in + static_cast<size_t>(frames) * channels);
+	const int history_frames = static_cast<int>(history.size()) / channels;
+	return produce(out, history_frames - radius);
+}
+
+int xs::mixer::resampler::flush(float* out)
+{
+	// Pad with silence so the filter can reach past the last frame
+	const int end = static_cast<int>(history.size()) / channels;
+	history.insert(history.end(), static_cast<size_t>(radius) * channels, 0.0f);
+	const int written = produce(out, end);
+
+	// Ready to start over
+	reset();
+	return written;
+}
+
+void xs::mixer::resampler::reset()
+{
+	// Silence before the first frame, so the first output is centered on it
+	history.assign(static_cast<size_t>(radius) * channels, 0.0f);
+	position = radius;
+}
+
+// Write outputs up to end (in history frames), then drop the history that is out of reach
+int xs::mixer::resampler::produce(float* out, double end)
+{
+	const auto& table = kernel();
+	const float* src = history.data();
+	const double reach = c_half_width;
+	int written = 0;
+
+	while (position < end)
+	{
+		const int center = static_cast<int>(position);
+		float* frame = out + static_cast<size_t>(written) * channels;
+		std::fill_n(frame, channels, 0.0f);
+
+		for (int i = center - radius + 1; i <= center + radius; i++)
+		{
+			const double x = std::abs(position - i) * scale;
+			if (x >= reach)
+				continue;
+
+			const double index = x * c_phases;
+			const int j = static_cast<int>(index);
+			const float t = static_cast<float>(index - j);
+			const float weight = table[j] + (table[j + 1] - table[j]) * t;
+
+			const float* sample = src + static_cast<size_t>(i) * channels;
+			for (int c = 0; c < channels; c++)
+				frame[c] += sample[c] * weight;
+		}
+
+		for (int c = 0; c < channels; c++)
+			frame[c] *= static_cast<float>(scale);
+
+		written++;
+		position += step;
+	}
+
+	// Keep the frames the next output still reaches
+	const int drop = std::max(0, static_cast<int>(position) - radius);
+	history.erase(history.begin(), history.begin() + static_cast<size_t>(drop) * channels);
+	position -= drop;
+	return written;
+}
+
+std::vector<float> xs::mixer::resample(const std::vector<float>& samples, int channels, int from_rate, int to_rate)
+{
+	const int frames = static_cast<int>(samples.size()) / channels;
+	resampler converter(channels, from_rate, to_rate);
+	std::vector<float> output(static_cast<size_t>(converter.max_output(frames)) * channels);
+	int written = converter.process(samples.data(), frames, output.data());
+	written += converter.flush(output.data() + static_cast<size_t>(written) * channels);
+	output.resize(static_cast<size_t>(written) * channels);
+	return output;
+}
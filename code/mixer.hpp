@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+// Mixing kernels for the software audio mixer. All buffers are 32 bit float,
+// stereo buffers are interleaved (left, right). The kernels add to the output
+// so several voices can be mixed into the same buffer.
+namespace xs::mixer
+{
+	/// Add a mono signal to a stereo buffer, with a gain per side
+	void mix_mono(float* out, const float* in, int frames, float gain_left, float gain_right);
+
+	/// Add a stereo signal to a stereo buffer, with a gain per side
+	void mix_stereo(float* out, const float* in, int frames, float gain_left, float gain_right);
+
+	/// Gains for a volume and a pan (-1 left, 0 center, 1 right). Center keeps the full volume on both sides.
+	void pan_gains(float volume, float pan, float& gain_left, float& gain_right);
+
+	/// Name of the instruction set the kernels were compiled for
+	const char* simd_name();
+
+	/// Windowed sinc sample rate converter for interleaved float audio. It keeps the
+	/// source frames it still needs between calls, so audio can be fed in chunks.
+	class resampler
+	{
+	public:
+		resampler() = default;
+		resampler(int channels, int from_rate, int to_rate);
+
+		/// Most frames process() or flush() can write for a chunk of input frames
+		int max_output(int input_frames) const;
+
+		/// Reserve memory for chunks of up to this many frames, so process() does not allocate
+		void reserve(int input_frames);
+
+		/// Resample a chunk of input, returns the number of frames written to out
+		int process(const float* in, int frames, float* out);
+
+		/// Write out what is left after the last chunk, returns the number of frames written
+		int flush(float* out);
+
+		/// Drop what is held back and start over, keeping the memory
+		void reset();
+
+	private:
+		int produce(float* out, double end);
+
+		std::vector<float> history;		// Source frames that are still in reach of the filter
+		int channels = 0;
+		int radius = 0;					// Filter reach in source frames, either side
+		double step = 1.0;				// Source frames per output frame
+		double scale = 1.0;				// Cutoff relative to the source rate
+		double position = 0.0;			// Next output, in source frames into the history
+	};
+
+	/// Resample a whole buffer of interleaved float audio
+	std::vector<float> resample(const std::vector<float>& samples, int channels, int from_rate, int to_rate);
+}
@@ -5,6 +5,10 @@
 #include "data.hpp"
 #include "input.hpp"
 #include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <glm/glm.hpp>
@@ -73,7 +77,14 @@ namespace xs::render
 		const GLchar* fragment_shader,
 		GLuint* program);
 	bool link_program(GLuint program);
-	void reload_shaders();
+
+	struct frame_packet;
+	void build_packet(frame_packet& packet);
+	void execute(const frame_packet& packet);
+	void start_render_thread();
+	void stop_render_thread();
+	void render_thread_loop();
+	void run_gl(const std::function<void()>& fn);
 
 	int width = -1;
 	int height = -1;	
@@ -146,9 +157,43 @@ namespace xs::render
 
 	unordered_map<int, mesh> meshes;
 	vector<render_instance> render_queue;
+	ivec2 clear_size = ivec2(-1);	// Screen size to clear, negative when clear() was not called
 
 	xs::render::stats render_stats = {};
 
+	// A frame as the GL side needs it. The main thread copies the render queue and the debug
+	// vertices into it and resolves the meshes and textures, so drawing it never reads
+	// anything the main thread changes while building the next frame.
+	struct packet_instance
+	{
+		instance_struct data;
+		unsigned int vao = 0;
+		unsigned int texture = 0;
+		uint32_t count = 0;
+	};
+
+	struct frame_packet
+	{
+		vector<packet_instance> instances;
+		vector<debug_vertex_format> triangles;
+		vector<debug_vertex_format> lines;
+		ivec2 clear_size = ivec2(-1);
+		bool reload_shaders = false;
+	};
+
+	// With the render thread on, it owns the GL context and draws packet N-1 while the main
+	// thread builds packet N. Other GL work (textures, meshes) is run on it through run_gl.
+	array<frame_packet, 2> packets;
+	int packet_index = 0;
+	int packets_in_flight = 0;
+	thread render_thread;
+	mutex thread_mutex;
+	condition_variable work_cv;			// Tasks for the render thread
+	condition_variable done_cv;			// A task or packet is done
+	deque<function<void()>> thread_tasks;
+	bool thread_running = false;			// Only changed by the main thread
+	thread_local bool on_render_thread = false;
+
 	// Used to enable include directive in GLSL.
 	// Nice for sharing code between shaders or even
 	// for sharing code between C++ and GLSL.
@@ -244,10 +289,23 @@ void xs::render::initialize()
 	gl_label(GL_VERTEX_ARRAY, triangles_vao, "triangles vao");
 	gl_label(GL_BUFFER, lines_vbo, "lines vbo");
 	gl_label(GL_BUFFER, triangles_vbo, "triangles vbo");
+
+	if (configuration::render_thread())
+	{
+#ifdef INSPECTOR
+		// ImGui draws with the same context on the main thread
+		log::warn("The render thread is not available with the inspector (build with XS_INSPECTOR=OFF), rendering on the main thread");
+#else
+		start_render_thread();
+#endif
+	}
 }
 
 void xs::render::shutdown()
 {
+	// Draws the frames that are still queued and gives the context back to the main thread
+	stop_render_thread();
+
 	if (instances_data) delete[] instances_data;
 
 	// Shutdown the render system in reverse order
@@ -283,12 +341,103 @@ void xs::render::shutdown()
 
 void xs::render::render()
 {	
-	if (xs::input::get_key_once(xs::input::KEY_F5))
-		reload_shaders();
-
+	XS_MEMORY_TAG(render);
 	XS_PROFILE_SECTION("xs::render::render");
+
+	if (!thread_running)
+	{
+		auto& packet = packets[0];
+		build_packet(packet);
+		execute(packet);
+		return;
+	}
+
+	// Double buffered, so the packet about to be filled is free once at most one is in flight
+	auto& packet = packets[packet_index];
+	{
+		XS_PROFILE_SECTION("xs::render::wait");
+		unique_lock<mutex> lock(thread_mutex);
+		done_cv.wait(lock, [] { return packets_in_flight < (int)packets.size(); });
+	}
+
+	build_packet(packet);
+
+	{
+		lock_guard<mutex> lock(thread_mutex);
+		packets_in_flight++;
+		thread_tasks.push_back([&packet] {
+			execute(packet);
+			device::end_frame();
+
+			lock_guard<mutex> lock(thread_mutex);
+			packets_in_flight--;
+			done_cv.notify_all();
+		});
+	}
+	work_cv.notify_one();
+	packet_index = (packet_index + 1) % (int)packets.size();
+}
+
+void xs::render::build_packet(frame_packet& packet)
+{
+	XS_PROFILE_SECTION("xs::render::build_packet");
+	packet.reload_shaders = xs::input::get_key_once(xs::input::KEY_F5);
+	packet.clear_size = clear_size;
+	clear_size = ivec2(-1);
+
+	std::stable_sort(render_queue.begin(), render_queue.end(),
+		[](const render_instance& lhs, const render_instance& rhs) {		
+			return lhs.z < rhs.z;
+		});
+
+	packet.instances.clear();
+	packet.instances.reserve(render_queue.size());
+	for (const auto& spe : render_queue)
+	{
+		if (spe.sprite_id == -1) continue;
+		auto& mesh = meshes[spe.sprite_id];
+		auto& img = images[mesh.image_id];
+
+		packet_instance instance;
+		instance.data.mul_color = spe.mul_color;
+		instance.data.add_color = spe.add_color;
+		instance.data.position = vec2((float)spe.x, (float)spe.y);
+		instance.data.scale = vec2((float)spe.scale, (float)spe.scale);
+		instance.data.rotation = (float)spe.rotation;
+		instance.data.flags = spe.flags;
+		instance.data.xy = mesh.xy;
+		instance.data.uv = mesh.uv;
+		instance.vao = mesh.vao;
+		instance.texture = img.texture;
+		instance.count = mesh.count;
+		packet.instances.push_back(instance);
+	}
+
+	packet.triangles.assign(&triangles_array[0], &triangles_array[0] + triangles_count * 3);
+	packet.lines.assign(&lines_array[0], &lines_array[0] + lines_count * 2);
+
 	render_stats = {};
+	render_stats.draw_calls = (int)packet.instances.size() +
+		(packet.triangles.empty() ? 0 : 1) +
+		(packet.lines.empty() ? 0 : 1);
+	render_stats.sprites = (int)meshes.size();
+	render_stats.textures = (int)images.size();
+}
+
+void xs::render::execute(const frame_packet& packet)
+{
+	XS_PROFILE_SECTION("xs::render::execute");
+	if (packet.reload_shaders)
+		reload_shaders();
 
+	// Black for letterbox bars
+	if (packet.clear_size.x >= 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, packet.clear_size.x, packet.clear_size.y);
+		glClearColor(0.0, 0.0, 0.0, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
 
 	// Clear the target FBO (can be MSAA or render_fbo)
 	glBindFramebuffer(GL_FRAMEBUFFER, msaa_fbo);
@@ -315,70 +464,47 @@ void xs::render::render()
 	glUseProgram(main_program);
 	glUniformMatrix4fv(0, 1, false, value_ptr(vp));
 
-	std::stable_sort(render_queue.begin(), render_queue.end(),
-		[](const render_instance& lhs, const render_instance& rhs) {		
-			return lhs.z < rhs.z;
-		});
-	
-	for (const auto& spe : render_queue)
+	for (const auto& instance : packet.instances)
 	{
-		if (spe.sprite_id == -1) continue;
-		auto& mesh = meshes[spe.sprite_id];
-		auto& img = images[mesh.image_id];
-		
 		// Set the texture
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, img.texture);
-
-
-		instances_data[0].mul_color = spe.mul_color;
-		instances_data[0].add_color = spe.add_color;
-		instances_data[0].position = vec2((float)spe.x, (float)spe.y);
-		instances_data[0].scale = vec2((float)spe.scale, (float)spe.scale);
-		instances_data[0].rotation = (float)spe.rotation;
-		instances_data[0].flags = spe.flags;
-		instances_data[0].xy = mesh.xy;
-		instances_data[0].uv = mesh.uv;
-
+		glBindTexture(GL_TEXTURE_2D, instance.texture);
 
+		instances_data[0] = instance.data;
 		glBindBuffer(GL_UNIFORM_BUFFER, instances_ubo);
 		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(instance_struct), &instances_data[0]);
 		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
 
 		// Bind the vertex array
-		glBindVertexArray(mesh.vao);
+		glBindVertexArray(instance.vao);
 
 		// Draw the mesh
-		glDrawElementsInstanced(GL_TRIANGLES, mesh.count, GL_UNSIGNED_SHORT, nullptr, 1);
+		glDrawElementsInstanced(GL_TRIANGLES, instance.count, GL_UNSIGNED_SHORT, nullptr, 1);
 
 		// Unbind the vertex array
 		XS_DEBUG_ONLY(glBindVertexArray(0));
-
-		render_stats.draw_calls++;
 	}
 	
 	glUseProgram(shader_program);
 	glUniformMatrix4fv(1, 1, false, value_ptr(vp));
 
-	if (triangles_count > 0)
+	if (!packet.triangles.empty())
 	{
 		glBindVertexArray(triangles_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, triangles_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(debug_vertex_format) * triangles_count * 3, &triangles_array[0], GL_DYNAMIC_DRAW);
-		glDrawArrays(GL_TRIANGLES, 0, triangles_count * 3);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(debug_vertex_format) * packet.triangles.size(), packet.triangles.data(), GL_DYNAMIC_DRAW);
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)packet.triangles.size());
 		XS_DEBUG_ONLY(glBindBuffer(GL_ARRAY_BUFFER, 0));
-		render_stats.draw_calls++;
 	}
 
-	if (lines_count > 0)
+	if (!packet.lines.empty())
 	{
 		glBindVertexArray(lines_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, lines_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(debug_vertex_format) * lines_count * 2, &lines_array[0], GL_DYNAMIC_DRAW);
-		glDrawArrays(GL_LINES, 0, lines_count * 2);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(debug_vertex_format) * packet.lines.size(), packet.lines.data(), GL_DYNAMIC_DRAW);
+		glDrawArrays(GL_LINES, 0, (GLsizei)packet.lines.size());
 		XS_DEBUG_ONLY(glBindBuffer(GL_ARRAY_BUFFER, 0));
-		render_stats.draw_calls++;
 	}
 
 	XS_DEBUG_ONLY(glBindBuffer(GL_ARRAY_BUFFER, 0));
@@ -407,9 +533,6 @@ void xs::render::render()
 
 	// Bind the default framebuffer for the editor
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	
-	render_stats.sprites = (int)meshes.size();
-	render_stats.textures = (int)images.size();
 }
 
 void xs::render::sprite(
@@ -423,6 +546,7 @@ void xs::render::sprite(
 	color add,
 	unsigned int flags)
 {
+	XS_MEMORY_TAG(render);
 	// Queue the sprite to render
 	render_instance instance;
 	instance.sprite_id = sprite_id;
@@ -455,12 +579,8 @@ void xs::render::sprite(
 
 void xs::render::clear()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	auto w = device::get_width();
-	auto h = device::get_height();
-	glViewport(0, 0, w, h);
-	glClearColor(0.0, 0.0, 0.0, 1.0f);  // Black for letterbox bars
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// The screen itself is cleared when the frame is drawn
+	clear_size = ivec2(device::get_width(), device::get_height());
 	
 	lines_count = 0;
 	triangles_count = 0;
@@ -469,6 +589,7 @@ void xs::render::clear()
 
 void xs::render::create_texture_with_data(xs::render::image& img, uchar* data)
 {
+	XS_MEMORY_TAG(render);
 	GLint format = GL_INVALID_VALUE;
 	GLint usage = GL_INVALID_VALUE;
 	switch (img.channels)
@@ -489,35 +610,99 @@ void xs::render::create_texture_with_data(xs::render::image& img, uchar* data)
 		assert(false);
 	}
 
-	bool filter_flag = data::get_bool("Texture Filter", data::type::project);
+	static const auto filter_key = data::intern("Texture Filter");
+	static const auto repeat_key = data::intern("Texture Repeat");
+
+	bool filter_flag = data::get_bool(filter_key, data::type::project);
+	auto filter = filter_flag ? GL_LINEAR : GL_NEAREST;
+
+	bool repeat_flag = data::get_bool(repeat_key, data::type::project);
+	auto repeat = repeat_flag ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+
+	run_gl([&] {
+		glGenTextures(1, &img.texture);
+		glBindTexture(GL_TEXTURE_2D, img.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repeat);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repeat);
+
+		glTexImage2D(
+			GL_TEXTURE_2D,						// What (target)
+			0,									// Mip-map level
+			format,								// Internal format
+			img.width,							// Width
+			img.height,							// Height
+			0,									// Border
+			usage,								// Format (how to use)
+			GL_UNSIGNED_BYTE,					// Type   (how to interpret)
+			data);								// Data
+
+		// Create mipmaps
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		gl_label(GL_TEXTURE, img.texture, img.file);
+		XS_DEBUG_ONLY(glBindTexture(GL_TEXTURE_2D, 0));
+	});
+}
+
+void xs::render::create_texture_with_levels(xs::render::image& img, const xs::texture::view& tex)
+{
+	XS_MEMORY_TAG(render);
+	GLint format = GL_RGBA8;
+	GLenum usage = GL_RGBA;
+	if (tex.info.pixel_format == texture::format::r8)
+	{
+		format = GL_R8;
+		usage = GL_RED;
+	}
+
+	static const auto filter_key = data::intern("Texture Filter");
+	static const auto repeat_key = data::intern("Texture Repeat");
+
+	bool filter_flag = data::get_bool(filter_key, data::type::project);
 	auto filter = filter_flag ? GL_LINEAR : GL_NEAREST;
 
-	bool repeat_flag = data::get_bool("Texture Repeat", data::type::project);
+	bool repeat_flag = data::get_bool(repeat_key, data::type::project);
 	auto repeat = repeat_flag ? GL_REPEAT : GL_CLAMP_TO_EDGE;
 
-	glGenTextures(1, &img.texture);
-	glBindTexture(GL_TEXTURE_2D, img.texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repeat);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repeat);
-
-	glTexImage2D(
-		GL_TEXTURE_2D,						// What (target)
-		0,									// Mip-map level
-		format,								// Internal format
-		img.width,							// Width
-		img.height,							// Height
-		0,									// Border
-		usage,								// Format (how to use)
-		GL_UNSIGNED_BYTE,					// Type   (how to interpret)
-		data);								// Data
-
-	// Create mipmaps
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	gl_label(GL_TEXTURE, img.texture, img.file);
-	XS_DEBUG_ONLY(glBindTexture(GL_TEXTURE_2D, 0));
+	run_gl([&] {
+		glGenTextures(1, &img.texture);
+		glBindTexture(GL_TEXTURE_2D, img.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repeat);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repeat);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)tex.levels.size() - 1);
+
+		// Single channel textures read as grayscale
+		if (tex.info.pixel_format == texture::format::r8)
+		{
+			GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+
+		// Levels are tightly packed, rows of R8 levels are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < tex.levels.size(); i++)
+		{
+			const auto& level = tex.levels[i];
+			glTexImage2D(
+				GL_TEXTURE_2D,
+				(GLint)i,
+				format,
+				level.width,
+				level.height,
+				0,
+				usage,
+				GL_UNSIGNED_BYTE,
+				level.data);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		gl_label(GL_TEXTURE, img.texture, img.file);
+		XS_DEBUG_ONLY(glBindTexture(GL_TEXTURE_2D, 0));
+	});
 }
 
 void xs::render::create_frame_buffers()
@@ -613,6 +798,9 @@ int xs::render::create_sprite(int image_id, double x0, double y0, double x1, dou
 	if (it != meshes.end())
 		return it->first;
 
+	// The mesh size comes from the image, so it needs to be loaded
+	wait_for_image(image_id);
+
 	// Create the sprite mesh
 	mesh mesh;
 	mesh.is_sprite = true;
@@ -653,38 +841,40 @@ int xs::render::create_sprite(int image_id, double x0, double y0, double x1, dou
 	};
 
 
-	glGenVertexArrays(1, &mesh.vao);
-	glBindVertexArray(mesh.vao);
-
-	// Create the index buffer
-	glGenBuffers(1, &mesh.ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(short), sprite_indices, GL_STATIC_DRAW);
-	mesh.count = 6;
-
-	// Create the vertex buffers
-	glGenBuffers(2, mesh.vbos.data());
-
-	// Create the position buffer
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(float), sprite_positions, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-	// Create the texture coordinate buffer
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(float), sprite_texture_coordinates, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	run_gl([&] {
+		glGenVertexArrays(1, &mesh.vao);
+		glBindVertexArray(mesh.vao);
 
-	string name = "sprite " + img.file + " " + to_string(key);
-	gl_label(GL_VERTEX_ARRAY, mesh.vao, name + "vao");
-	gl_label(GL_BUFFER, mesh.ebo, name + "ebo");
-	gl_label(GL_BUFFER, mesh.vbos[0], name + " position vbo");
-	gl_label(GL_BUFFER, mesh.vbos[1], name + " texture vbo");
+		// Create the index buffer
+		glGenBuffers(1, &mesh.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(short), sprite_indices, GL_STATIC_DRAW);
+		mesh.count = 6;
+
+		// Create the vertex buffers
+		glGenBuffers(2, mesh.vbos.data());
+
+		// Create the position buffer
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+		glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(float), sprite_positions, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+		// Create the texture coordinate buffer
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
+		glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(float), sprite_texture_coordinates, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+		string name = "sprite " + img.file + " " + to_string(key);
+		gl_label(GL_VERTEX_ARRAY, mesh.vao, name + "vao");
+		gl_label(GL_BUFFER, mesh.ebo, name + "ebo");
+		gl_label(GL_BUFFER, mesh.vbos[0], name + " position vbo");
+		gl_label(GL_BUFFER, mesh.vbos[1], name + " texture vbo");
 
-	// Unbind the vertex array
-	XS_DEBUG_ONLY(glBindVertexArray(0));
+		// Unbind the vertex array
+		XS_DEBUG_ONLY(glBindVertexArray(0));
+	});
 
 	// Store the mesh
 	mesh.image_id = image_id;
@@ -705,32 +895,34 @@ int xs::render::create_shape(
 	mesh.is_sprite = false;
 	auto key = tools::random_id();
 
-	glGenVertexArrays(1, &mesh.vao);
-	glBindVertexArray(mesh.vao);
+	run_gl([&] {
+		glGenVertexArrays(1, &mesh.vao);
+		glBindVertexArray(mesh.vao);
 
-	// Create the index buffer
-	glGenBuffers(1, &mesh.ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(unsigned short), indices, GL_STATIC_DRAW);
-	mesh.count = index_count;
+		// Create the index buffer
+		glGenBuffers(1, &mesh.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(unsigned short), indices, GL_STATIC_DRAW);
+		mesh.count = index_count;
 
-	// Create the vertex buffers
-	glGenBuffers(2, mesh.vbos.data());
+		// Create the vertex buffers
+		glGenBuffers(2, mesh.vbos.data());
 
-	// Create the position buffer
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), positions, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+		// Create the position buffer
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), positions, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
-	// Create the texture coordinate buffer
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), texture_coordinates, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+		// Create the texture coordinate buffer
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), texture_coordinates, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
-	// Unbind the vertex array
-	glBindVertexArray(0);
+		// Unbind the vertex array
+		glBindVertexArray(0);
+	});
 
 	// Store the mesh
 	mesh.image_id = image_id;
@@ -746,9 +938,12 @@ void xs::render::destroy_shape(int sprite_id)
 		auto& mesh = it->second;
 		if(!mesh.is_sprite) 
 		{
-			glDeleteVertexArrays(1, &mesh.vao);
-			glDeleteBuffers(1, &mesh.ebo);
-			glDeleteBuffers(4, mesh.vbos.data());
+			// Queued after the frames that still draw it
+			run_gl([&] {
+				glDeleteVertexArrays(1, &mesh.vao);
+				glDeleteBuffers(1, &mesh.ebo);
+				glDeleteBuffers(4, mesh.vbos.data());
+			});
 			meshes.erase(it);
 		}
 	}
@@ -932,13 +1127,88 @@ bool xs::render::link_program(GLuint program)
 
 void xs::render::reload_shaders()
 {
-	// Delete the old shaders
-	glDeleteProgram(main_program);
-	glDeleteProgram(shader_program);
+	run_gl([] {
+		// Delete the old shaders
+		glDeleteProgram(main_program);
+		glDeleteProgram(shader_program);
+
+		// Recompile the shaders
+		compile_draw_shader();
+		compile_sprite_shader();
+	});
+}
 
-	// Recompile the shaders
-	compile_draw_shader();
-	compile_sprite_shader();
+bool xs::render::has_render_thread()
+{
+	return thread_running;
+}
+
+void xs::render::start_render_thread()
+{
+	// The context can only be current on one thread at a time
+	device::release_context();
+	thread_running = true;
+	render_thread = thread(render_thread_loop);
+	log::info("Rendering on a separate thread");
+}
+
+void xs::render::stop_render_thread()
+{
+	if (!thread_running)
+		return;
+
+	{
+		lock_guard<mutex> lock(thread_mutex);
+		thread_running = false;
+	}
+	work_cv.notify_one();
+	render_thread.join();
+	device::acquire_context();
+}
+
+void xs::render::render_thread_loop()
+{
+	on_render_thread = true;
+	profiler::set_thread_name("Render thread");
+	device::acquire_context();
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(thread_mutex);
+			work_cv.wait(lock, [] { return !thread_tasks.empty() || !thread_running; });
+
+			// Stopping, but only once everything queued is done
+			if (thread_tasks.empty())
+				break;
+			task = std::move(thread_tasks.front());
+			thread_tasks.pop_front();
+		}
+		task();
+	}
+	device::release_context();
+}
+
+// Runs GL calls on the thread that owns the context and returns when they are done.
+// Tasks run in order with the frames, so whatever was queued before still sees the old state.
+void xs::render::run_gl(const function<void()>& fn)
+{
+	if (on_render_thread || !thread_running)
+	{
+		fn();
+		return;
+	}
+
+	bool done = false;
+	unique_lock<mutex> lock(thread_mutex);
+	thread_tasks.push_back([&fn, &done] {
+		fn();
+		lock_guard<mutex> lock(thread_mutex);
+		done = true;
+		done_cv.notify_all();
+	});
+	work_cv.notify_one();
+	done_cv.wait(lock, [&done] { return done; });
 }
 
 using namespace std;
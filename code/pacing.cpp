@@ -0,0 +1,184 @@
+#include "pacing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "configuration.hpp"
+#include "device.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+#include "xs.hpp"
+
+using namespace std;
+
+namespace xs::pacing::internal
+{
+	using clock = chrono::steady_clock;
+
+	// Sleeping can overshoot by a millisecond or more, so the end of the wait is spun
+	constexpr chrono::microseconds c_spin_margin(2000);
+
+	mode current_mode = mode::vsync;
+	bool mode_set = false;
+	bool initialized = false;
+	double target_fps = 60.0;
+	clock::duration period = {};
+	clock::time_point deadline = {};
+	clock::time_point last_frame = {};
+	stats last_stats = {};
+
+	void sleep_until(clock::time_point until);
+}
+
+using namespace xs;
+using namespace xs::pacing::internal;
+
+void xs::pacing::initialize()
+{
+	if (!mode_set)
+	{
+		const auto name = configuration::frame_pacing();
+		if (!name.empty() && !parse_mode(name, current_mode))
+			log::warn("Unknown frame pacing '{}', using vsync", name);
+		target_fps = configuration::target_fps();
+	}
+
+	// Nothing to sync to without a visible window
+	if (xs::is_headless())
+		current_mode = mode::uncapped;
+
+	switch (current_mode)
+	{
+	case mode::vsync:
+		device::set_swap_interval(1);
+		break;
+	case mode::adaptive:
+		if (!device::set_swap_interval(-1))
+		{
+			log::warn("Adaptive vsync is not supported, using vsync");
+			current_mode = mode::vsync;
+			device::set_swap_interval(1);
+		}
+		break;
+	case mode::fps:
+	case mode::uncapped:
+		device::set_swap_interval(0);
+		break;
+	}
+
+	if (target_fps <= 0.0)
+		target_fps = 60.0;
+	period = chrono::duration_cast<clock::duration>(chrono::duration<double>(1.0 / target_fps));
+	deadline = clock::now();
+	last_frame = deadline;
+	last_stats = {};
+	initialized = true;
+
+	if (current_mode == mode::fps)
+		log::info("Frame pacing: {} at {} fps", mode_name(current_mode), target_fps);
+	else
+		log::info("Frame pacing: {}", mode_name(current_mode));
+}
+
+void xs::pacing::set_mode(mode m, double fps)
+{
+	// The swap interval is only set in initialize, and after that the context may belong to the render thread
+	if (initialized)
+	{
+		log::warn("Frame pacing can only be changed before it is initialized, keeping {}", mode_name(current_mode));
+		return;
+	}
+
+	current_mode = m;
+	mode_set = true;
+	if (fps > 0.0)
+		target_fps = fps;
+}
+
+xs::pacing::mode xs::pacing::get_mode()
+{
+	return current_mode;
+}
+
+void xs::pacing::wait()
+{
+	XS_PROFILE_SECTION("xs::pacing::wait");
+
+	if (current_mode == mode::fps)
+	{
+		// A frame that ran late starts the schedule over, rather than rushing the next frames to catch up
+		deadline += period;
+		const auto now = clock::now();
+		if (deadline < now)
+			deadline = now;
+		else
+			sleep_until(deadline);
+	}
+
+	const auto now = clock::now();
+	const double frame_ms = chrono::duration<double, milli>(now - last_frame).count();
+	last_frame = now;
+
+	// Without a target the smoothed frame time is what the frames should have taken
+	stats s;
+	s.frame_ms = frame_ms;
+	s.average_ms = last_stats.average_ms > 0.0 ?
+		last_stats.average_ms + (frame_ms - last_stats.average_ms) * 0.1 :
+		frame_ms;
+	const double expected_ms = current_mode == mode::fps ?
+		chrono::duration<double, milli>(period).count() :
+		s.average_ms;
+	s.jitter_ms = std::abs(frame_ms - expected_ms);
+	last_stats = s;
+
+	if (profiler::capturing())
+	{
+		profiler::counter("Frame time (ms)", s.frame_ms);
+		profiler::counter("Frame jitter (ms)", s.jitter_ms);
+	}
+}
+
+xs::pacing::stats xs::pacing::get_stats()
+{
+	return last_stats;
+}
+
+bool xs::pacing::parse_mode(const std::string& name, mode& m)
+{
+	for (auto candidate : { mode::vsync, mode::adaptive, mode::fps, mode::uncapped })
+	{
+		if (name == mode_name(candidate))
+		{
+			m = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* xs::pacing::mode_name(mode m)
+{
+	switch (m)
+	{
+	case mode::vsync: return "vsync";
+	case mode::adaptive: return "adaptive";
+	case mode::fps: return "fps";
+	case mode::uncapped: return "uncapped";
+	}
+	return "vsync";
+}
+
+void xs::pacing::internal::sleep_until(clock::time_point until)
+{
+	// Sleep most of the way, then spin for the rest
+	while (true)
+	{
+		const auto left = until - clock::now();
+		if (left <= clock::duration::zero())
+			return;
+		if (left > c_spin_margin)
+			this_thread::sleep_for(left - c_spin_margin);
+		else
+			this_thread::yield();
+	}
+}
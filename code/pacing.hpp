@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+
+namespace xs::pacing
+{
+	/// How frames are paced
+	enum class mode
+	{
+		vsync,		// Wait for the display on every swap
+		adaptive,	// Wait for the display, but swap right away when a frame is late (tear instead of stutter)
+		fps,		// No vsync, sleep to hit a target frame rate
+		uncapped	// No vsync and no waiting, as fast as it goes (for benchmarks)
+	};
+
+	/// Timing of the last frame, in milliseconds
+	struct stats
+	{
+		double frame_ms = 0.0;		// Time from the end of the previous frame to the end of this one
+		double average_ms = 0.0;	// Smoothed frame time
+		double jitter_ms = 0.0;		// How far the frame time was from the target (or the average without one)
+	};
+
+	/// Pick the mode from the project settings ("Frame pacing" and "Target FPS") unless it was set
+	/// already, and set the swap interval to match. Called after the device is initialized.
+	void initialize();
+
+	/// Use this mode instead of the project settings. Must be called before initialize,
+	/// later calls are ignored with a warning.
+	void set_mode(mode m, double target_fps = 0.0);
+
+	/// The mode in use
+	mode get_mode();
+
+	/// End the frame: wait for the target frame rate in fps mode and measure the frame time
+	/// (called once per frame)
+	void wait();
+
+	/// Timing of the last frame
+	stats get_stats();
+
+	/// Parse "vsync", "adaptive", "fps" or "uncapped", returns false for anything else
+	bool parse_mode(const std::string& name, mode& m);
+
+	/// Name of a mode, as parse_mode takes it
+	const char* mode_name(mode m);
+}
@@ -3,6 +3,8 @@
 #include "fileio.hpp"
 #include "log.hpp"
 #include "version.hpp"
+#include "texture.hpp"
+#include "jobs.hpp"
 #include "miniz.h"
 #include <filesystem>
 #include <fstream>
@@ -182,6 +184,29 @@ namespace packager
 			}
 			return false;
 		}
+
+		bool is_image_file(const std::string& extension)
+		{
+			return extension == ".png" || extension == ".jpg";
+		}
+
+		bool compress_data(const std::vector<std::byte>& source, std::vector<std::byte>& compressed)
+		{
+			unsigned long src_len = static_cast<unsigned long>(source.size());
+			unsigned long compressed_size = compressBound(src_len);
+
+			compressed.resize(compressed_size);
+
+			int result = compress(
+				reinterpret_cast<unsigned char*>(compressed.data()), &compressed_size,
+				reinterpret_cast<const unsigned char*>(source.data()), src_len);
+
+			if (result != Z_OK)
+				return false;
+
+			compressed.resize(compressed_size);
+			return true;
+		}
 	}
 
 	bool create_package(const std::string& output_path)
@@ -196,6 +221,16 @@ namespace packager
 		// Define which wildcards to package
 		std::vector<std::string> wildcards_to_package = { "[game]", "[shared]" };
 
+		// Find the files first, packing them is spread over the job system
+		struct source_file
+		{
+			fs::path path;
+			std::string relative_path;
+			std::string extension;
+			uint64_t size;
+		};
+		std::vector<source_file> sources;
+
 		for (const auto& wildcard : wildcards_to_package)
 		{
 			// Check if wildcard is defined
@@ -216,7 +251,6 @@ namespace packager
 
 			log::info("Packaging {}: {}", wildcard, wildcard_path);
 
-			// Single-pass iteration: read and process all files
 			for (const auto& entry : fs::recursive_directory_iterator(source_dir))
 			{
 				if (should_skip_entry(entry))
@@ -231,8 +265,6 @@ namespace packager
 				if (!is_supported_file_format(extension))
 					continue;
 
-				package_entry content;
-
 				// Store path with wildcard prefix: "[game]/images/sprite.png"
 				std::string rel_path_str = rel_path.string();
 				// Normalize path separators to forward slashes
@@ -241,48 +273,72 @@ namespace packager
 					if (c == '\\')
 						c = '/';
 				}
-				content.relative_path = wildcard + "/" + rel_path_str;
-				content.uncompressed_size = entry.file_size();
-
-				// Read file data
-				std::vector<std::byte> file_data = fileio::read_binary_file(entry.path().string());
-
-				// Compress text files
-				if (is_text_file(extension))
-				{
-					unsigned long src_len = static_cast<unsigned long>(file_data.size());
-					unsigned long compressed_size = compressBound(src_len);
+				sources.push_back({ entry.path(), wildcard + "/" + rel_path_str, extension, entry.file_size() });
+			}
+		}
 
-					content.data.resize(compressed_size);
+		// Reading, baking and compressing are independent per file
+		std::vector<package_entry> packed(sources.size());
+		std::vector<char> ok(sources.size(), 0);
+		jobs::parallel_for(0, static_cast<int>(sources.size()), [&](int i)
+		{
+			const source_file& source = sources[i];
+			package_entry& content = packed[i];
+			content.relative_path = source.relative_path;
+			content.uncompressed_size = source.size;
 
-					int result = compress(
-						reinterpret_cast<unsigned char*>(content.data.data()), &compressed_size,
-						reinterpret_cast<const unsigned char*>(file_data.data()), src_len);
+			// Read file data
+			std::vector<std::byte> file_data = fileio::read_binary_file(source.path.string());
 
-					if (result != Z_OK)
-					{
-						log::error("Failed to compress {}", content.relative_path);
-						continue;
-					}
+			// Images are decoded now and stored ready for upload, with mipmaps
+			std::vector<std::byte> baked;
+			if (is_image_file(source.extension))
+				baked = texture::bake(file_data);
 
-					content.data.resize(compressed_size);
-					content.is_compressed = true;
-
-					log::info("Packed (compressed): {} ({} -> {} bytes)",
-						content.relative_path, src_len, compressed_size);
-				}
-				else
+			// Compress text files
+			if (is_text_file(source.extension))
+			{
+				if (!compress_data(file_data, content.data))
 				{
-					// Binary files are stored uncompressed
-					content.data = std::move(file_data);
-					content.is_compressed = false;
+					log::error("Failed to compress {}", content.relative_path);
+					return;
+				}
+				content.is_compressed = true;
 
-					log::info("Packed: {} ({} bytes)",
-						content.relative_path, content.data.size());
+				log::info("Packed (compressed): {} ({} -> {} bytes)",
+					content.relative_path, file_data.size(), content.data.size());
+			}
+			// Baked images compress well, the mip chain is a third extra
+			else if (!baked.empty())
+			{
+				if (!compress_data(baked, content.data))
+				{
+					log::error("Failed to compress {}", content.relative_path);
+					return;
 				}
+				content.uncompressed_size = baked.size();
+				content.is_compressed = true;
+
+				log::info("Packed (baked): {} ({} -> {} bytes)",
+					content.relative_path, file_data.size(), content.data.size());
+			}
+			else
+			{
+				// Binary files are stored uncompressed
+				content.data = std::move(file_data);
+				content.is_compressed = false;
 
-				pkg.entries.push_back(std::move(content));
+				log::info("Packed: {} ({} bytes)",
+					content.relative_path, content.data.size());
 			}
+			ok[i] = 1;
+		}, 1, "xs::packager::pack_file");
+
+		// Same order as the directory walk, so packages stay reproducible
+		for (size_t i = 0; i < packed.size(); i++)
+		{
+			if (ok[i])
+				pkg.entries.push_back(std::move(packed[i]));
 		}
 
 		// Calculate offsets for each entry in the data section
@@ -1,63 +1,646 @@
 #include "profiler.hpp"
+#include "fileio.hpp"
+#include "log.hpp"
+#include <json/json.hpp>
+#include <algorithm>
 #include <unordered_map>
 #include <deque>
 #include <chrono>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <cstdlib>
 #include <imgui/imgui.h>
 #include <implot/implot.h>
 
-//TODO: Create a macro to turn profiling on/off
-
 namespace xs::profiler::internal
 {
     using time_t = std::chrono::time_point<std::chrono::steady_clock>;
     using span_t = std::chrono::nanoseconds;
 
+    enum class event_type : uint32_t { begin, end };
+
+    struct event
+    {
+        int64_t time;       // Nanoseconds on the steady clock
+        uint32_t id;
+        event_type type;
+    };
+
+    // Events of one thread. Only that thread writes and only the main thread reads,
+    // so the two indices are all the synchronization needed.
+    struct ring
+    {
+        static constexpr uint64_t capacity = 1 << 14;
+        event events[capacity];
+        std::atomic<uint64_t> head{ 0 };    // Written by the owning thread
+        std::atomic<uint64_t> tail{ 0 };    // Written by the reader
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<bool> retired{ false };    // The owning thread has exited
+        bool free = false;                      // Drained, a new thread can take it
+        std::thread::id thread;
+        std::string name;                       // Guarded by rings_mutex
+    };
+
+    // Retires the ring of a thread when the thread exits, so short lived threads
+    // don't leave a ring behind each
+    struct ring_owner
+    {
+        ring* owned = nullptr;
+        ~ring_owner() { if (owned) owned->retired.store(true, std::memory_order_release); }
+    };
+
+    // A scope in the call tree of one frame, children are linked through siblings
+    struct node
+    {
+        uint32_t id = 0;
+        int parent = -1;
+        int first_child = -1;
+        int next_sibling = -1;
+        int64_t total = 0;
+        int count = 0;
+    };
+
+    // A scope that began but has not ended yet, can stay open over several frames
+    struct open_span
+    {
+        uint32_t id;
+        int64_t start;
+        int node;           // Node in this frame's tree, -1 until needed
+    };
+
+    // Deeper than this is a begin without an end, not real nesting
+    constexpr size_t c_max_stack_depth = 256;
+
+    struct thread_tree
+    {
+        ring* source = nullptr;
+        std::vector<node> nodes;
+        std::vector<open_span> stack;
+    };
+
     struct entry
     {
-	    time_t start{};
-	    time_t end{};
 	    span_t accum{};
         int count = 0;
 	    float avg = 0.0f;
 	    std::deque<float> history;
     };
-    std::unordered_map<std::string, entry> times;
+
+    // Scope names, the index is the scope id
+    std::mutex names_mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_ids;
+
+    // Rings of all threads that recorded something
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<ring>> rings;
+    thread_local ring_owner local_ring;
+    thread_local std::string local_name;        // Given to the ring of this thread when it is made
+
+    // Built by end_frame, read by the inspector
+    std::vector<thread_tree> trees;
+    std::vector<entry> times;
+    std::thread::id main_thread;
+
+    // A finished span or a counter value, kept while capturing
+    struct capture_span
+    {
+        int64_t start;
+        int64_t duration;
+        uint32_t id;
+        int thread;
+    };
+
+    struct capture_value
+    {
+        int64_t time;
+        uint32_t id;
+        double value;
+    };
+
+    int capture_frames = 0;         // Frames left to capture
+    std::string capture_file;
+    std::vector<capture_span> capture_spans;
+    std::vector<capture_value> capture_values;
+    std::vector<int64_t> capture_frame_ends;
+    std::vector<std::string> capture_frame_args;    // Allocations of each frame, as JSON
+
+    // Allocations made during one frame
+    struct alloc_count
+    {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct alloc_site
+    {
+        uint32_t id;
+        alloc_count allocs;
+    };
+
+    // Script allocations, only the main thread (where the VM runs) counts these
+    alloc_count script_allocs;
+    std::unordered_map<uint32_t, alloc_count> script_sites;
+
+    // Engine allocations per tag, counted from any thread
+    constexpr size_t tag_count = static_cast<size_t>(memory_tag::count);
+    const char* tag_names[tag_count] = { "other", "render", "audio", "fileio", "data" };
+    std::atomic<uint64_t> tag_allocs[tag_count];
+    std::atomic<uint64_t> tag_bytes[tag_count];
+    thread_local memory_tag current_tag = memory_tag::other;
+
+    // Allocations of the last frame, read by the inspector
+    alloc_count frame_script;
+    std::vector<alloc_site> frame_sites;        // Most bytes first
+    alloc_count frame_tags[tag_count];
+    std::deque<float> script_kb_history;
 
     time_t timer{};
+
+    uint32_t intern(const std::string& name);
+    ring& get_ring();
+    std::string thread_name(const thread_tree& tree, size_t index);
+    void record(uint32_t id, event_type type);
+    int child(thread_tree& tree, int parent, uint32_t id);
+    int node_for(thread_tree& tree, size_t level);
+    void build(thread_tree& tree, int thread);
+    int64_t now();
+    void collect_allocations();
+    void write_capture();
+    void inspect_node(const thread_tree& tree, int index);
 }
 
 using namespace xs::profiler;
 using namespace xs::profiler::internal;
 
-profiler_section::profiler_section(const std::string& name) : m_name(name)
+scope::scope(const char* name) : id(intern(name))
+{
+}
+
+uint32_t xs::profiler::internal::intern(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(names_mutex);
+    auto it = name_ids.find(name);
+    if (it != name_ids.end())
+        return it->second;
+
+    const auto id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    name_ids.emplace(name, id);
+    return id;
+}
+
+ring& xs::profiler::internal::get_ring()
+{
+    if (!local_ring.owned)
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (auto& r : rings)
+        {
+            if (r->free)
+            {
+                local_ring.owned = r.get();
+                break;
+            }
+        }
+
+        if (!local_ring.owned)
+        {
+            rings.push_back(std::make_unique<ring>());
+            local_ring.owned = rings.back().get();
+        }
+
+        local_ring.owned->free = false;
+        local_ring.owned->retired.store(false, std::memory_order_relaxed);
+        local_ring.owned->thread = std::this_thread::get_id();
+        local_ring.owned->name = local_name;
+    }
+    return *local_ring.owned;
+}
+
+std::string xs::profiler::internal::thread_name(const thread_tree& tree, size_t index)
+{
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    if (!tree.source->name.empty())
+        return tree.source->name;
+    return tree.source->thread == main_thread ? "Main thread" : "Thread " + std::to_string(index);
+}
+
+void xs::profiler::internal::record(uint32_t id, event_type type)
+{
+    ring& r = get_ring();
+    const uint64_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= ring::capacity)
+    {
+        // Nobody is reading (or the frame is huge), drop rather than block
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    r.events[head & (ring::capacity - 1)] = { now(), id, type };
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+int64_t xs::profiler::internal::now()
 {
-    begin_section(m_name);
+    const auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<span_t>(time).count();
 }
 
-profiler_section::~profiler_section()
+void xs::profiler::begin(uint32_t id)
 {
-    end_section(m_name);
+#if XS_PROFILER
+    record(id, event_type::begin);
+#endif
+}
+
+void xs::profiler::end(uint32_t id)
+{
+#if XS_PROFILER
+    record(id, event_type::end);
+#endif
 }
 
 void xs::profiler::begin_section(const std::string& name)
 {
-#if defined(PLATFORM_PC) || defined(PLATFORM_SWITCH) || defined(PLATFORM_APPLE) || defined(PLATFORM_LINUX)
-    times[name].start = std::chrono::steady_clock::now();
+#if XS_PROFILER
+    begin(intern(name));
 #endif
 }
 
 void xs::profiler::end_section(const std::string& name)
 {
-#if defined(PLATFORM_PC) || defined(PLATFORM_SWITCH) || defined(PLATFORM_APPLE) || defined(PLATFORM_LINUX)
-    auto& e = times[name];
-    e.end = std::chrono::steady_clock::now();
-    auto elapsed = e.end - e.start;
-    e.accum += elapsed;
-    e.count++;
+#if XS_PROFILER
+    end(intern(name));
+#endif
+}
+
+// Find or add the child of a node (or a root, for parent -1) with an id
+int xs::profiler::internal::child(thread_tree& tree, int parent, uint32_t id)
+{
+    int last = -1;
+    int index = parent >= 0 ? tree.nodes[parent].first_child : (tree.nodes.empty() ? -1 : 0);
+    for (; index >= 0; index = tree.nodes[index].next_sibling)
+    {
+        if (tree.nodes[index].id == id)
+            return index;
+        last = index;
+    }
+
+    const int added = static_cast<int>(tree.nodes.size());
+    node n;
+    n.id = id;
+    n.parent = parent;
+    tree.nodes.push_back(n);
+    if (last >= 0)
+        tree.nodes[last].next_sibling = added;
+    else if (parent >= 0)
+        tree.nodes[parent].first_child = added;
+    return added;
+}
+
+// Node of an open span, spans that began in an earlier frame get their nodes on demand
+int xs::profiler::internal::node_for(thread_tree& tree, size_t level)
+{
+    auto& span = tree.stack[level];
+    if (span.node < 0)
+    {
+        const int parent = level > 0 ? node_for(tree, level - 1) : -1;
+        span.node = child(tree, parent, span.id);
+    }
+    return span.node;
+}
+
+// Turn the events recorded since the last frame into a call tree
+void xs::profiler::internal::build(thread_tree& tree, int thread)
+{
+    tree.nodes.clear();
+    for (auto& span : tree.stack)
+        span.node = -1;
+
+    ring& r = *tree.source;
+    const uint64_t head = r.head.load(std::memory_order_acquire);
+    uint64_t tail = r.tail.load(std::memory_order_relaxed);
+    for (; tail < head; tail++)
+    {
+        const event& e = r.events[tail & (ring::capacity - 1)];
+        if (e.type == event_type::begin)
+        {
+            // Begins that never end (a script error between Profiler.begin and end)
+            // can't grow the stack without bound
+            if (tree.stack.size() < c_max_stack_depth)
+                tree.stack.push_back({ e.id, e.time, -1 });
+            continue;
+        }
+
+        // Spans above the matching begin never got their end, drop them.
+        // Ends without a matching begin (dropped events) are skipped.
+        size_t level = tree.stack.size();
+        while (level > 0 && tree.stack[level - 1].id != e.id)
+            level--;
+        if (level == 0)
+            continue;
+        tree.stack.resize(level);
+
+        const auto& span = tree.stack.back();
+        const int index = node_for(tree, tree.stack.size() - 1);
+        tree.nodes[index].total += e.time - span.start;
+        tree.nodes[index].count++;
+        if (capture_frames > 0)
+            capture_spans.push_back({ span.start, e.time - span.start, e.id, thread });
+        tree.stack.pop_back();
+    }
+    r.tail.store(tail, std::memory_order_release);
+}
+
+void xs::profiler::end_frame()
+{
+#if XS_PROFILER
+    if (main_thread == std::thread::id())
+        main_thread = std::this_thread::get_id();
+
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (size_t i = trees.size(); i < rings.size(); i++)
+        {
+            thread_tree tree;
+            tree.source = rings[i].get();
+            trees.push_back(std::move(tree));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        if (times.size() < names.size())
+            times.resize(names.size());
+    }
+
+    // Per scope totals for the plot, summed over all threads
+    for (auto& e : times)
+    {
+        e.accum = {};
+        e.count = 0;
+    }
+
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        auto& tree = trees[i];
+
+        // Read before draining, so the last events of an exited thread are included
+        const bool retired = tree.source->retired.load(std::memory_order_acquire);
+
+        build(tree, static_cast<int>(i));
+        for (const auto& n : tree.nodes)
+        {
+            // Scopes named by other threads since the resize above
+            if (n.id >= times.size())
+                times.resize(n.id + 1);
+            times[n.id].accum += span_t(n.total);
+            times[n.id].count += n.count;
+        }
+
+        if (retired)
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            tree.stack.clear();
+            tree.source->retired.store(false, std::memory_order_relaxed);
+            tree.source->free = true;
+        }
+    }
+
+    for (auto& e : times)
+    {
+        float duration = (float)((double)e.accum.count() / 1000000.0);
+        if (e.history.size() > 100)
+            e.history.pop_front();
+        e.history.push_back(duration);
+
+        e.avg = 0.0f;
+        for (float f : e.history)
+            e.avg += f;
+
+        e.avg /= (float)e.history.size();
+    }
+
+    collect_allocations();
+
+    if (capture_frames > 0)
+    {
+        capture_frame_ends.push_back(now());
+        if (--capture_frames == 0)
+            write_capture();
+    }
+#endif
+}
+
+// Move the allocations counted during the frame to the inspector and the capture
+void xs::profiler::internal::collect_allocations()
+{
+    frame_script = script_allocs;
+    script_allocs = {};
+
+    frame_sites.clear();
+    for (const auto& [id, allocs] : script_sites)
+        frame_sites.push_back({ id, allocs });
+    script_sites.clear();
+    std::sort(frame_sites.begin(), frame_sites.end(),
+        [](const alloc_site& a, const alloc_site& b) { return a.allocs.bytes > b.allocs.bytes; });
+
+    for (size_t i = 0; i < tag_count; i++)
+    {
+        frame_tags[i].count = tag_allocs[i].exchange(0, std::memory_order_relaxed);
+        frame_tags[i].bytes = tag_bytes[i].exchange(0, std::memory_order_relaxed);
+    }
+
+    const float script_kb = (float)((double)frame_script.bytes / 1024.0);
+    if (script_kb_history.size() > 100)
+        script_kb_history.pop_front();
+    script_kb_history.push_back(script_kb);
+
+    if (capture_frames <= 0)
+        return;
+
+    static const uint32_t allocations_id = intern("Script allocations");
+    static const uint32_t allocated_id = intern("Script allocated (KB)");
+    const int64_t time = now();
+    capture_values.push_back({ time, allocations_id, (double)frame_script.count });
+    capture_values.push_back({ time, allocated_id, script_kb });
+#if XS_MEMORY_TAGS
+    static std::vector<uint32_t> tag_ids;
+    if (tag_ids.empty())
+    {
+        for (size_t i = 0; i < tag_count; i++)
+            tag_ids.push_back(intern(std::string("Allocated (KB) ") + tag_names[i]));
+    }
+    for (size_t i = 0; i < tag_count; i++)
+        capture_values.push_back({ time, tag_ids[i], (double)frame_tags[i].bytes / 1024.0 });
+#endif
+
+    // The biggest call sites go in the args of the frame marker, shown when it is selected
+    nlohmann::json args;
+    args["script_allocations"] = frame_script.count;
+    args["script_bytes"] = frame_script.bytes;
+    auto& sites = args["script_sites"] = nlohmann::json::object();
+    {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        for (size_t i = 0; i < frame_sites.size() && i < 16; i++)
+            sites[names[frame_sites[i].id]] = frame_sites[i].allocs.bytes;
+    }
+#if XS_MEMORY_TAGS
+    auto& tags = args["engine_bytes"] = nlohmann::json::object();
+    for (size_t i = 0; i < tag_count; i++)
+        tags[tag_names[i]] = frame_tags[i].bytes;
+#endif
+    capture_frame_args.push_back(args.dump());
+}
+
+void xs::profiler::set_thread_name(const std::string& name)
+{
+#if XS_PROFILER
+    local_name = name;
+    if (local_ring.owned)
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        local_ring.owned->name = name;
+    }
+#endif
+}
+
+void xs::profiler::counter(const std::string& name, double value)
+{
+#if XS_PROFILER
+    if (capture_frames > 0)
+        capture_values.push_back({ now(), intern(name), value });
+#endif
+}
+
+void xs::profiler::capture(int frames, const std::string& filename)
+{
+#if XS_PROFILER
+    if (capture_frames > 0)
+    {
+        log::warn("Profiler capture already running, {} frames left", capture_frames);
+        return;
+    }
+
+    capture_frames = std::max(frames, 1);
+    capture_file = filename;
+    capture_spans.clear();
+    capture_values.clear();
+    capture_frame_ends.clear();
+    capture_frame_args.clear();
+    log::info("Profiler capturing {} frames", capture_frames);
+#else
+    log::warn("Profiler is compiled out (XS_PROFILER=0), nothing to capture");
 #endif
 }
 
+bool xs::profiler::capturing()
+{
+    return capture_frames > 0;
+}
+
+uint32_t xs::profiler::get_id(const std::string& name)
+{
+    return intern(name);
+}
+
+void xs::profiler::script_allocation(uint32_t site, size_t bytes)
+{
+#if XS_PROFILER
+    script_allocs.count++;
+    script_allocs.bytes += bytes;
+    auto& allocs = script_sites[site];
+    allocs.count++;
+    allocs.bytes += bytes;
+#endif
+}
+
+memory_section::memory_section(memory_tag tag) : m_previous(current_tag)
+{
+    current_tag = tag;
+}
+
+memory_section::~memory_section()
+{
+    current_tag = m_previous;
+}
+
+// Chrome Trace Event format, spans as complete events and counters as counter events
+void xs::profiler::internal::write_capture()
+{
+    if (capture_spans.empty() && capture_values.empty())
+    {
+        log::warn("Profiler capture is empty, nothing written");
+        return;
+    }
+
+    // Times are written in microseconds from the first thing captured
+    int64_t origin = capture_frame_ends.front();
+    for (const auto& span : capture_spans)
+        origin = std::min(origin, span.start);
+    for (const auto& value : capture_values)
+        origin = std::min(origin, value.time);
+    auto us = [origin](int64_t ns) { return std::to_string((double)(ns - origin) / 1000.0); };
+
+    std::vector<std::string> quoted;
+    {
+        std::lock_guard<std::mutex> lock(names_mutex);
+        quoted.reserve(names.size());
+        for (const auto& name : names)
+            quoted.push_back(nlohmann::json(name).dump());
+    }
+
+    std::string text;
+    text.reserve(capture_spans.size() * 96 + capture_values.size() * 96 + 1024);
+    text += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // Thread names
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        text += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(i) +
+            ",\"args\":{\"name\":" + nlohmann::json(thread_name(trees[i], i)).dump() + "}},\n";
+    }
+
+    for (const auto& span : capture_spans)
+    {
+        text += "{\"name\":" + quoted[span.id] + ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(span.thread) +
+            ",\"ts\":" + us(span.start) + ",\"dur\":" + std::to_string((double)span.duration / 1000.0) + "},\n";
+    }
+
+    for (const auto& value : capture_values)
+    {
+        text += "{\"name\":" + quoted[value.id] + ",\"ph\":\"C\",\"pid\":1,\"ts\":" + us(value.time) +
+            ",\"args\":{\"value\":" + std::to_string(value.value) + "}},\n";
+    }
+
+    // Frame boundaries as global instant events
+    for (size_t i = 0; i < capture_frame_ends.size(); i++)
+    {
+        text += "{\"name\":\"Frame " + std::to_string(i) + "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" +
+            us(capture_frame_ends[i]);
+        if (i < capture_frame_args.size())
+            text += ",\"args\":" + capture_frame_args[i];
+        text += "}";
+        text += i + 1 < capture_frame_ends.size() ? ",\n" : "\n";
+    }
+    text += "]}\n";
+
+    if (fileio::write_text_file(text, capture_file))
+        log::info("Profiler capture of {} frames written to {}", capture_frame_ends.size(), fileio::get_path(capture_file));
+    else
+        log::error("Failed to write profiler capture to {}", capture_file);
+
+    capture_spans.clear();
+    capture_values.clear();
+    capture_frame_ends.clear();
+    capture_frame_args.clear();
+}
+
 void xs::profiler::begin_timing()
 {
 #if defined(PLATFORM_PC) || defined(PLATFORM_SWITCH) || defined(PLATFORM_APPLE) || defined(PLATFORM_LINUX)
@@ -76,53 +659,174 @@ double xs::profiler::end_timing()
 #endif
 }
 
-void xs::profiler::inspect()
+void xs::profiler::internal::inspect_node(const thread_tree& tree, int index)
 {
-#if defined(PLATFORM_PC) || defined(PLATFORM_SWITCH) || defined(PLATFORM_APPLE) || defined(PLATFORM_LINUX)
-    for (auto& itr : times)
+    for (; index >= 0; index = tree.nodes[index].next_sibling)
     {
-        auto& e = itr.second;
-        float duration = (float)((double)e.accum.count() / 1000000.0);
-        if (e.history.size() > 100)
-            e.history.pop_front();
-        e.history.push_back(duration);
+        const auto& n = tree.nodes[index];
+        const float ms = (float)((double)n.total / 1000000.0);
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+        if (n.first_child < 0)
+            flags |= ImGuiTreeNodeFlags_Leaf;
 
-        e.avg = 0.0f;
-        for (float f : e.history)
-            e.avg += f;
+        ImGui::PushID(index);
+        const bool open = ImGui::TreeNodeEx(names[n.id].c_str(), flags, "%s  %.3fms  x%d", names[n.id].c_str(), ms, n.count);
+        if (open)
+        {
+            inspect_node(tree, n.first_child);
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
+    }
+}
 
-        e.avg /= (float)e.history.size();
+void xs::profiler::inspect()
+{
+#if defined(PLATFORM_PC) || defined(PLATFORM_SWITCH) || defined(PLATFORM_APPLE) || defined(PLATFORM_LINUX)
+    // Capture to a file, to look at single frames in Perfetto
+    static int frames = 120;
+    if (capturing())
+    {
+        ImGui::Text("Capturing, %d frames left", capture_frames);
+    }
+    else
+    {
+        ImGui::SetNextItemWidth(100.0f);
+        ImGui::InputInt("##frames", &frames);
+        frames = std::max(frames, 1);
+        ImGui::SameLine();
+        if (ImGui::Button("Capture frames"))
+            capture(frames, "[user]/profiler_capture.json");
     }
 
+    std::lock_guard<std::mutex> lock(names_mutex);
+
     if (ImPlot::BeginPlot("Profiler", ImVec2(-1, 200)))
     {
         ImPlot::SetupAxes("Sample", "Time");
         ImPlot::SetupAxesLimits(0, 50, 0, 20);
-        for (auto& itr : times)
+        for (size_t i = 0; i < times.size(); i++)
         {
-            auto& e = itr.second;
+            auto& e = times[i];
+            if (e.history.empty())
+                continue;
 
             std::vector<float> vals(
                 e.history.begin(),
                 e.history.end());
 
             ImPlot::PushStyleVar(ImPlotStyleVar_FillAlpha, 0.25f);
-            ImPlot::PlotShaded(itr.first.c_str(), vals.data(), (int)vals.size());
+            ImPlot::PlotShaded(names[i].c_str(), vals.data(), (int)vals.size());
             ImPlot::PopStyleVar();
-            ImPlot::PlotLine(itr.first.c_str(), vals.data(), (int)vals.size());
+            ImPlot::PlotLine(names[i].c_str(), vals.data(), (int)vals.size());
         }
         ImPlot::EndPlot();
     }
 
-    for (auto& itr : times)
-        ImGui::LabelText(itr.first.c_str(), "%fms count:%d", itr.second.avg, itr.second.count);
+    for (size_t i = 0; i < times.size(); i++)
+        ImGui::LabelText(names[i].c_str(), "%fms count:%d", times[i].avg, times[i].count);
+
+    // Call tree of the last frame, per thread
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        const auto& tree = trees[i];
+        if (tree.nodes.empty())
+            continue;
+
+        const auto dropped = tree.source->dropped.load(std::memory_order_relaxed);
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::CollapsingHeader(thread_name(tree, i).c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (dropped > 0)
+                ImGui::Text("%llu events dropped", (unsigned long long)dropped);
+            inspect_node(tree, 0);
+        }
+        ImGui::PopID();
+    }
 
-    for (auto& itr : times)
+    // Allocations of the last frame, to find what feeds the garbage collector
+    if (ImGui::CollapsingHeader("Allocations"))
     {
-        itr.second.accum = {};
-        itr.second.count = 0;
+        ImGui::Text("Script: %llu allocations, %.1f KB",
+            (unsigned long long)frame_script.count, (double)frame_script.bytes / 1024.0);
+
+        if (ImPlot::BeginPlot("Script allocated", ImVec2(-1, 120)))
+        {
+            ImPlot::SetupAxes("Frame", "KB", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit);
+            ImPlot::SetupAxisLimits(ImAxis_X1, 0, 100);
+            std::vector<float> vals(script_kb_history.begin(), script_kb_history.end());
+            ImPlot::PlotBars("KB", vals.data(), (int)vals.size());
+            ImPlot::EndPlot();
+        }
+
+        for (size_t i = 0; i < frame_sites.size() && i < 20; i++)
+        {
+            const auto& site = frame_sites[i];
+            ImGui::LabelText(names[site.id].c_str(), "%.2f KB  x%llu",
+                (double)site.allocs.bytes / 1024.0, (unsigned long long)site.allocs.count);
+        }
+
+#if XS_MEMORY_TAGS
+        ImGui::Separator();
+        for (size_t i = 0; i < tag_count; i++)
+        {
+            ImGui::LabelText(tag_names[i], "%.2f KB  x%llu",
+                (double)frame_tags[i].bytes / 1024.0, (unsigned long long)frame_tags[i].count);
+        }
+#else
+        ImGui::TextDisabled("Build with XS_MEMORY_TAGS=1 to count engine allocations per subsystem");
+#endif
     }
 #endif
 }
 
+#if XS_MEMORY_TAGS
+// Replaces the global allocation functions, allocations outside a tagged scope count as other
+static void* counted_alloc(std::size_t size)
+{
+    const auto tag = static_cast<size_t>(current_tag);
+    tag_allocs[tag].fetch_add(1, std::memory_order_relaxed);
+    tag_bytes[tag].fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* p = counted_alloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
 
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+// Kept out of line, otherwise the compiler inlines free() next to a new and warns about the mismatch
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void counted_free(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+#endif
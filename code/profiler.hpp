@@ -1,22 +1,101 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
-#define XS_PROFILE_FUNCTION() xs::profiler::profiler_section s_sect(__FUNCTION__)
-#define XS_PROFILE_SECTION(id) xs::profiler::profiler_section s_sect(id)
+// Profiling is cheap enough to leave on, build with XS_PROFILER=0 to compile it out
+#ifndef XS_PROFILER
+#define XS_PROFILER 1
+#endif
+
+// Counting C++ allocations per subsystem replaces the global operator new, so it is opt-in
+#ifndef XS_MEMORY_TAGS
+#define XS_MEMORY_TAGS 0
+#endif
+
+#define XS_PROFILE_CONCAT_INNER(a, b) a##b
+#define XS_PROFILE_CONCAT(a, b) XS_PROFILE_CONCAT_INNER(a, b)
+
+#if XS_PROFILER
+// Every macro site gets its own static scope, so the name is registered once and
+// a section only records an id and a timestamp
+#define XS_PROFILE_SECTION(name) \
+	static const xs::profiler::scope XS_PROFILE_CONCAT(s_scope_, __LINE__)(name); \
+	xs::profiler::profiler_section XS_PROFILE_CONCAT(s_sect_, __LINE__)(XS_PROFILE_CONCAT(s_scope_, __LINE__))
+#define XS_PROFILE_FUNCTION() XS_PROFILE_SECTION(__FUNCTION__)
+#else
+#define XS_PROFILE_SECTION(name)
+#define XS_PROFILE_FUNCTION()
+#endif
+
+#if XS_MEMORY_TAGS
+// Count the allocations made on this thread until the end of the scope towards a subsystem
+#define XS_MEMORY_TAG(tag) \
+	xs::profiler::memory_section XS_PROFILE_CONCAT(s_mem_, __LINE__)(xs::profiler::memory_tag::tag)
+#else
+#define XS_MEMORY_TAG(tag)
+#endif
 
 namespace xs::profiler
 {
+	/// A profiled scope, one static instance per macro site
+	struct scope
+	{
+		scope(const char* name);
+		uint32_t id;
+	};
+
+	/// Record the start and end of a scope on the calling thread
+	void begin(uint32_t id);
+	void end(uint32_t id);
+
+	/// Records a begin when created and an end when destroyed
 	class profiler_section
 	{
 	public:
-		profiler_section(const std::string& name);
-		~profiler_section();
+		profiler_section(const scope& s) : m_id(s.id) { begin(m_id); }
+		~profiler_section() { end(m_id); }
 	private:
-		std::string m_name;
+		uint32_t m_id;
 	};
 
+	/// Begin and end a scope by name (slower, the name is looked up every time)
 	void begin_section(const std::string& name);
 	void end_section(const std::string& name);
+
+	/// Name the calling thread in captures and the inspector (call when the thread starts)
+	void set_thread_name(const std::string& name);
+
+	/// Collect what all threads recorded and build the call tree of the frame (called once per frame)
+	void end_frame();
+
+	/// Record a value to show as a counter track in captures (only kept while capturing)
+	void counter(const std::string& name, double value);
+
+	/// Capture the next frames and write them to a Chrome Trace Event file (open in Perfetto or chrome://tracing)
+	void capture(int frames, const std::string& filename);
+
+	/// Whether a capture is running
+	bool capturing();
+
+	/// Id of a name only known at run time, scopes and allocation sites share the ids
+	uint32_t get_id(const std::string& name);
+
+	/// Count a script allocation towards a call site (main thread only)
+	void script_allocation(uint32_t site, size_t bytes);
+
+	/// Subsystems that engine allocations can be counted towards
+	enum class memory_tag : uint8_t { other, render, audio, fileio, data, count };
+
+	/// Counts the allocations of the calling thread towards a tag while it lives
+	class memory_section
+	{
+	public:
+		memory_section(memory_tag tag);
+		~memory_section();
+	private:
+		memory_tag m_previous;
+	};
+
 	void begin_timing();
 	double end_timing();
 	void inspect();
@@ -18,6 +18,7 @@
 #include "device.hpp"
 #include "profiler.hpp"
 #include "inspector.hpp"
+#include "loader.hpp"
 
 // Include stb_image 
 #ifdef PLATFORM_SWITCH
@@ -94,12 +95,16 @@ namespace xs::render
 #ifdef CAN_RELOAD_IMAGES
 	std::vector<uint64_t> last_write_times;
 #endif
+
+	// Callbacks waiting on images that are still loading
+	std::unordered_map<int, std::vector<std::function<void(int)>>> image_callbacks;
 }
 
 using namespace xs;
 
 int xs::render::load_font(const std::string& font_file, double size)
 {	
+	XS_MEMORY_TAG(render);
 	// Find image first
 	auto id = std::hash<std::string>{}(font_file + std::to_string(size));
 	for (size_t i = 0; i < fonts.size(); i++)
@@ -195,6 +200,7 @@ int xs::render::get_image_height(int image_id)
 		log::error("get_image_height() image_id={} is invalid!", image_id);
 		return -1;
 	}
+	wait_for_image(image_id);
 	auto& img = images[image_id];
 	return img.height;
 }
@@ -205,6 +211,7 @@ int xs::render::get_image_width(int image_id)
 		log::error("get_image_width() image_id={} is invalid!", image_id);
 		return -1;
 	}
+	wait_for_image(image_id);
 
 	auto& img = images[image_id];
 	return img.width;
@@ -230,6 +237,7 @@ void xs::render::text(
 	color add,
 	unsigned int flags)
 {
+	XS_MEMORY_TAG(render);
 	if(font_id < 0 || font_id >= static_cast<int>(fonts.size()))
 	{
 		log::error("render_text() font_id={} is invalid!", font_id);
@@ -300,16 +308,40 @@ void xs::render::text(
 
 int xs::render::load_image(const std::string& image_file)
 {	
+	XS_MEMORY_TAG(render);
 	// Find image first
 	auto id = std::hash<std::string>{}(image_file);
 	for (size_t i = 0; i < images.size(); i++)
+	{
 		if (images[i].string_id == id)
+		{
+			wait_for_image(static_cast<int>(i));
 			return static_cast<int>(i);
+		}
+	}
 
 	auto buffer = fileio::read_binary_file(image_file);	
 	image img;
 	img.string_id = id;
 	img.file = image_file;
+
+	// Packaged images are baked and can be uploaded as they are
+	texture::view baked;
+	if (texture::read(buffer, baked))
+	{
+		img.width = (int)baked.info.width;
+		img.height = (int)baked.info.height;
+		img.channels = (int)baked.info.channels;
+		create_texture_with_levels(img, baked);
+
+		const auto i = images.size();
+		images.push_back(img);
+#ifdef CAN_RELOAD_IMAGES
+		last_write_times.push_back(0);
+#endif
+		return static_cast<int>(i);
+	}
+
 	uchar* data = stbi_load_from_memory(
 		reinterpret_cast<unsigned char*>(buffer.data()),
 		static_cast<int>(buffer.size()),
@@ -343,6 +375,149 @@ int xs::render::load_image(const std::string& image_file)
 	return static_cast<int>(i);
 }
 
+int xs::render::load_image_async(const std::string& image_file, const std::function<void(int)>& on_ready)
+{
+	// Find image first, still report back asynchronously when already loaded
+	auto id = std::hash<std::string>{}(image_file);
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		if (images[i].string_id == id)
+		{
+			const int image_id = static_cast<int>(i);
+			if (on_ready)
+			{
+				if (images[i].loading)
+					image_callbacks[image_id].push_back(on_ready);
+				else
+					loader::defer([image_id, on_ready]() { on_ready(image_id); });
+			}
+			return image_id;
+		}
+	}
+
+	// Reserve the slot now so the id can be handed out right away
+	const int image_id = static_cast<int>(images.size());
+	image img;
+	img.string_id = id;
+	img.file = image_file;
+	img.loading = true;
+	images.push_back(img);
+#ifdef CAN_RELOAD_IMAGES
+	last_write_times.push_back(0);
+#endif
+	if (on_ready)
+		image_callbacks[image_id].push_back(on_ready);
+
+	struct decoded
+	{
+		uchar* data = nullptr;
+		int width = -1;
+		int height = -1;
+		int channels = -1;
+		vector<std::byte> buffer;		// Kept for baked images
+		texture::view baked;
+		bool is_baked = false;
+	};
+	auto result = make_shared<decoded>();
+
+	// Read and decode on a loader thread
+	auto work = [image_file, result]() {
+		result->buffer = fileio::read_binary_file(image_file);
+		auto& buffer = result->buffer;
+		if (buffer.empty())
+			return;
+		if (texture::read(buffer, result->baked))
+		{
+			result->is_baked = true;
+			return;
+		}
+		result->data = stbi_load_from_memory(
+			reinterpret_cast<unsigned char*>(buffer.data()),
+			static_cast<int>(buffer.size()),
+			&result->width,
+			&result->height,
+			&result->channels,
+			4);
+		buffer.clear();
+		buffer.shrink_to_fit();
+	};
+
+	// Upload on the main thread
+	auto finish = [image_id, image_file, result]() {
+		auto& img = images[image_id];
+		img.loading = false;
+
+		// The callbacks can call into scripts, so they wait for the loader's update
+		// (this can run from a flush inside a foreign call)
+		auto report = [callbacks = std::move(image_callbacks[image_id])](int id) {
+			if (!callbacks.empty())
+				loader::defer([callbacks, id]() {
+					for (auto& callback : callbacks)
+						callback(id);
+				});
+		};
+		image_callbacks.erase(image_id);
+
+		if (result->is_baked)
+		{
+			img.width = (int)result->baked.info.width;
+			img.height = (int)result->baked.info.height;
+			img.channels = (int)result->baked.info.channels;
+			create_texture_with_levels(img, result->baked);
+			report(image_id);
+			return;
+		}
+
+		if (result->data == nullptr)
+		{
+			// Leave the slot unusable but keep the ids of other images stable
+			img.string_id = 0;
+			log::error("Image {} could not be loaded!", image_file);
+			xs::inspector::notify(
+				xs::inspector::notification_type::error,
+				"Image " + image_file + " could not be loaded!",
+				5);
+			report(-1);
+			return;
+		}
+
+		img.width = result->width;
+		img.height = result->height;
+		img.channels = result->channels;
+		create_texture_with_data(img, result->data);
+		stbi_image_free(result->data);
+		result->data = nullptr;
+
+#ifdef CAN_RELOAD_IMAGES
+		last_write_times[image_id] = xs::fileio::last_write(image_file);
+#endif
+		report(image_id);
+	};
+
+	images[image_id].load_ticket = loader::submit(work, finish);
+	return image_id;
+}
+
+bool xs::render::is_image_ready(int image_id)
+{
+	if (image_id < 0 || image_id >= static_cast<int>(images.size()))
+		return false;
+	const auto& img = images[image_id];
+	return !img.loading && img.width > 0;
+}
+
+void xs::render::wait_for_image(int image_id)
+{
+	if (image_id < 0 || image_id >= static_cast<int>(images.size()))
+		return;
+
+	if (images[image_id].loading)
+	{
+		log::warn("Image {} used before it finished loading, waiting for it", images[image_id].file);
+		loader::wait(images[image_id].load_ticket);
+	}
+}
+
 struct shape
 {
 	int image_id = -1;
@@ -355,6 +530,7 @@ struct shape
 
 int render::load_shape(const std::string& shape_file)
 {
+	XS_MEMORY_TAG(render);
 	auto buffer = fileio::read_binary_file(shape_file);
 
 	vector<vec2> positions;
@@ -619,46 +795,76 @@ void xs::render::dbg_text(const std::string& text, double x, double y, double si
 
 #ifdef CAN_RELOAD_IMAGES
 
+namespace
+{
+	bool reload_image_at(size_t i, uint64_t new_time)
+	{
+		auto& image = xs::render::images[i];
+		auto buffer = fileio::read_binary_file(image.file);
+		uchar* data = stbi_load_from_memory(
+			reinterpret_cast<unsigned char*>(buffer.data()),
+			static_cast<int>(buffer.size()),
+			&image.width,
+			&image.height,
+			&image.channels,
+			4);
+
+		if (data != nullptr)
+		{
+			log::info("Image {} reloaded!", image.file);
+			auto message = XS_FORMAT("Image {} reloaded!", image.file);
+			inspector::notify(inspector::notification_type::success, message, 4.0f);
+			xs::render::last_write_times[i] = new_time;
+			xs::render::create_texture_with_data(image, data);
+			stbi_image_free(data);
+			return true;
+		}
+		else
+		{
+			log::error("Image {} could not be reloaded!", image.file);
+			auto message = XS_FORMAT("Image {} could not be reloaded!", image.file);
+			inspector::notify(inspector::notification_type::error, message, 5.0f);
+			return false;
+		}
+	}
+}
+
 int xs::render::reload_images()
 {
+	fileio::invalidate_cache();
 	int reloaded = 0;
 	for (size_t i = 0; i < images.size(); i++) {
 		auto& image = images[i];
 
-		if (image.file.empty())
+		if (image.file.empty() || image.loading)
 			continue;
 
 		auto last_time = last_write_times[i];
 		
 		auto new_time = xs::fileio::last_write(image.file);
 
-		if (new_time > last_time) {
-			auto buffer = fileio::read_binary_file(image.file);
-			uchar* data = stbi_load_from_memory(
-				reinterpret_cast<unsigned char*>(buffer.data()),
-				static_cast<int>(buffer.size()),
-				&image.width,
-				&image.height,
-				&image.channels,
-				4);
-
-			if (data != nullptr)
-			{
-				log::info("Image {} reloaded!", image.file);
-				auto message = XS_FORMAT("Image {} reloaded!", image.file);
-				inspector::notify(inspector::notification_type::success, message, 4.0f);
-				last_write_times[i] = new_time;
-				create_texture_with_data(image, data);
-				stbi_image_free(data);
-				reloaded++;	
-			}
-			else
-			{
-				log::error("Image {} could not be reloaded!", image.file);
-				auto message = XS_FORMAT("Image {} could not be reloaded!", image.file);
-				inspector::notify(inspector::notification_type::error, message, 5.0f);
-			}
-		}
+		if (new_time > last_time && reload_image_at(i, new_time))
+			reloaded++;
+	}
+	return reloaded;
+}
+
+int xs::render::reload_image(const std::string& image_file)
+{
+	// Images can be loaded with or without wildcards, so also compare full paths
+	const auto full_path = fileio::get_path(image_file);
+	int reloaded = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		auto& image = images[i];
+
+		if (image.file.empty() || image.loading)
+			continue;
+
+		if (image.file != image_file && fileio::get_path(image.file) != full_path)
+			continue;
+
+		if (reload_image_at(i, xs::fileio::last_write(image.file)))
+			reloaded++;
 	}
 	return reloaded;
 }
@@ -667,6 +873,8 @@ int xs::render::reload_images()
 
 int xs::render::reload_images() { return 0; }
 
+int xs::render::reload_image(const std::string& image_file) { return 0; }
+
 #endif
 
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <functional>
 #include "color.hpp"
 
 namespace xs::render
@@ -41,12 +42,28 @@ namespace xs::render
 	/// (Hot) reload all images in use
 	int reload_images();
 
+	/// (Hot) reload a single image, if it is in use
+	int reload_image(const std::string& image_file);
+
+	/// (Hot) reload the shaders
+	void reload_shaders();
+
+	/// Whether frames are drawn and presented on the render thread (project setting "Render thread")
+	bool has_render_thread();
+
 	/// Set the offset for the rendering - used for camera movement
 	void set_offset(double x, double y);
 
 	/// Load an image from a file (png or jpg)
 	int load_image(const std::string& image_file);
 
+	/// Load an image on a loader thread. The id is valid right away, but the image is only
+	/// usable once is_image_ready returns true. The callback gets the id (or -1 on failure).
+	int load_image_async(const std::string& image_file, const std::function<void(int)>& on_ready = nullptr);
+
+	/// Check if an image has finished loading
+	bool is_image_ready(int image_id);
+
 	/// Load a shape from a file (svg)
 	int load_shape(const std::string& shape_file);
 
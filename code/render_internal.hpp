@@ -1,10 +1,12 @@
 #pragma once
 #include "render.hpp"
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 #include <stb/stb_truetype.h>
 #include "platform.hpp"
+#include "texture.hpp"
 
 namespace xs::render
 {	
@@ -16,6 +18,8 @@ namespace xs::render
 		int							channels	= -1;
 		std::size_t					string_id	= 0;
 		std::string					file;
+		bool						loading		= false;
+		uint64_t					load_ticket	= 0;
 	};
 	
 	struct font_atlas
@@ -57,6 +61,8 @@ namespace xs::render
     inline void rotate_vector3d(glm::vec4& vec, float radians);
 	inline void rotate_vector2d(glm::vec2& vec, float radians);
 	void create_texture_with_data(xs::render::image& img, uchar* data);
+	void create_texture_with_levels(xs::render::image& img, const xs::texture::view& tex);
+	void wait_for_image(int image_id);
 }
 
 inline void xs::render::rotate_vector3d(glm::vec3& vec, float radians)
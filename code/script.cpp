@@ -62,12 +62,105 @@ namespace xs::script::internal
     WrenHandle* init_method = nullptr;
     WrenHandle* update_method = nullptr;
     WrenHandle* render_method = nullptr;
+    bool render_alpha = false;                          // Game.render takes the interpolation alpha
+    WrenHandle* call_method = nullptr;                  // Fn.call(_) used for callbacks
+    std::unordered_map<int, WrenHandle*> callbacks;     // Pending callbacks from async work
+    int next_callback_id = 0;                           // Not reset, so stale ids never match
     std::unordered_map<size_t, WrenForeignMethodFn> foreign_methods;
     std::unordered_map<size_t, WrenForeignClassMethods> foreign_classes;
     struct module { string path; string source; };
     std::unordered_map<string, module> modules; // name to source mapping
+    struct module_file { string filename; xs::fileio::path_handle handle; };
+    std::unordered_map<string, module_file> module_files;   // Where each import was found, kept across reloads
     bool initialized = false;
     bool error = false;
+    bool fixed_seed = false;                            // Random.new() is seeded from random_seed, not the clock
+    uint32_t random_seed = 0;
+    uint32_t random_count = 0;                          // Generators seeded so far, each gets its own seed
+
+    // Random.new() with a fixed seed, goes through the seed_(_) of the random module
+    void seed_random(WrenVM* vm)
+    {
+        static const WrenForeignMethodFn seed_one = wrenRandomBindForeignMethod(vm, "Random", false, "seed_(_)");
+        wrenEnsureSlots(vm, 2);
+        wrenSetSlotDouble(vm, 1, (double)(random_seed + random_count++));
+        seed_one(vm);
+    }
+
+    // Whether a class has a static method, without calling it
+    bool has_static_method(WrenHandle* class_handle, const char* signature)
+    {
+        ObjClass* meta = AS_CLASS(class_handle->value)->obj.classObj;
+        const int symbol = wrenSymbolTableFind(&vm->methodNames, signature, strlen(signature));
+        return symbol >= 0 && symbol < meta->methods.count && meta->methods.data[symbol].type != METHOD_NONE;
+    }
+
+    // Put in front of every block the VM allocates
+    struct alignas(std::max_align_t) allocation_header
+    {
+        size_t size;        // Bytes the VM asked for
+        uint32_t site;      // Profiler id, for blocks that hold an ObjFn
+    };
+    constexpr uint32_t c_no_site = UINT32_MAX;
+
+    allocation_header* header_of(void* memory)
+    {
+        return static_cast<allocation_header*>(memory) - 1;
+    }
+
+    // Script function that is running, named like in stack traces (core functions are skipped)
+    uint32_t allocation_site()
+    {
+        static const uint32_t compiler_site = profiler::get_id("(compiler)");
+        static const uint32_t engine_site = profiler::get_id("(engine)");
+        if (!vm || vm->compiler)
+            return vm ? compiler_site : engine_site;
+
+        ObjFiber* fiber = vm->fiber;
+        for (int i = fiber ? fiber->numFrames - 1 : -1; i >= 0; i--)
+        {
+            const ObjFn* fn = fiber->frames[i].closure->fn;
+            if (fn->module == nullptr || fn->module->name == nullptr)
+                continue;
+
+            // The id is kept with the function's memory, so it goes away when the function does
+            auto header = header_of(const_cast<ObjFn*>(fn));
+            if (header->site == c_no_site)
+            {
+                const char* fn_name = fn->debug->name[0] ? fn->debug->name : "(function)";
+                const string name = string(fn->module->name->value) + ": " + fn_name;
+                header->site = profiler::get_id(name);
+            }
+            return header->site;
+        }
+        return engine_site;
+    }
+
+    // All VM memory goes through here, so the profiler can see which scripts make garbage
+    void* reallocateFn(void* memory, size_t new_size, void* user_data)
+    {
+        auto header = memory ? header_of(memory) : nullptr;
+        if (new_size == 0)
+        {
+            free(header);
+            return nullptr;
+        }
+
+#if XS_PROFILER
+        // Growing a buffer only counts the bytes it grew by
+        const size_t old_size = header ? header->size : 0;
+        if (new_size > old_size)
+            profiler::script_allocation(allocation_site(), new_size - old_size);
+#endif
+
+        auto block = static_cast<allocation_header*>(realloc(header, sizeof(allocation_header) + new_size));
+        if (!block)
+            return nullptr;
+        if (!header)
+            block->site = c_no_site;
+        block->size = new_size;
+        return block + 1;
+    }
 
     void writeFn(WrenVM* vm, const char* text)
     {
@@ -130,7 +223,11 @@ namespace xs::script::internal
         const char* signature)
     {
         if (strcmp(module, "random") == 0)
+        {
+            if (fixed_seed && strcmp(class_name, "Random") == 0 && !is_static && strcmp(signature, "seed_()") == 0)
+                return seed_random;
             return wrenRandomBindForeignMethod(vm, class_name, is_static, signature);
+        }
 
         if (strcmp(module, "meta") == 0)
             return wrenMetaBindForeignMethod(vm, class_name, is_static, signature);
@@ -173,20 +270,28 @@ namespace xs::script::internal
         else
         {
             string sname(name);
-            auto filename = "[shared]/modules/" + sname + ".wren";
-            if (!xs::fileio::exists(filename))
+
+            // Imports are resolved once, a reload reads from where the module was found before
+            auto& file = module_files[sname];
+            if (!file.handle.valid() || !xs::fileio::exists(file.handle))
             {
-                auto mstring = string(main);
-                auto i = mstring.find_last_of('/');
-                filename = mstring.erase(i) + '/' + sname + ".wren";
-                if (!xs::fileio::exists(filename))
+                file.filename = "[shared]/modules/" + sname + ".wren";
+                file.handle = xs::fileio::resolve(file.filename);
+                if (!xs::fileio::exists(file.handle))
                 {
-                    log::warn("Module '{}' can not be found!", name);
+                    auto mstring = string(main);
+                    auto i = mstring.find_last_of('/');
+                    file.filename = mstring.erase(i) + '/' + sname + ".wren";
+                    file.handle = xs::fileio::resolve(file.filename);
+                    if (!xs::fileio::exists(file.handle))
+                    {
+                        log::warn("Module '{}' can not be found!", name);
+                    }
                 }
             }
             auto& m = modules[sname];
-            m.path = filename;
-            m.source = xs::fileio::read_text_file(filename);
+            m.path = file.filename;
+            m.source = xs::fileio::read_text_file(file.handle);
             res.source = m.source.c_str();
         }
         return res;
@@ -201,6 +306,7 @@ void xs::script::configure()
 
     initialized = false;
     error = false;
+    random_count = 0;
 
     main = fileio::get_path("[game]/[main]"); 
 
@@ -220,6 +326,7 @@ void xs::script::configure()
     config.bindForeignMethodFn = &bindForeignMethod;
     config.bindForeignClassFn = &bindForeignClass;
     config.loadModuleFn = &loadModule;    
+    config.reallocateFn = &reallocateFn;
     vm = wrenNewVM(&config);
 
     const string& script_file = fileio::read_text_file(main);
@@ -266,7 +373,9 @@ void xs::script::configure()
         wrenSetSlotHandle(vm, 0, game_class);					// Put Game class in slot 0
         init_method = wrenMakeCallHandle(vm, "initialize()");
         update_method = wrenMakeCallHandle(vm, "update(_)");
-        render_method = wrenMakeCallHandle(vm, "render()");
+        render_alpha = has_static_method(game_class, "render(_)");
+        render_method = wrenMakeCallHandle(vm, render_alpha ? "render(_)" : "render()");
+        call_method = wrenMakeCallHandle(vm, "call(_)");
     }
 
     auto timing = xs::profiler::end_timing();
@@ -308,6 +417,14 @@ void xs::script::shutdown()
             wrenReleaseHandle(vm, render_method);
             render_method = nullptr;
         }
+        if (call_method)
+        {
+            wrenReleaseHandle(vm, call_method);
+            call_method = nullptr;
+        }
+        for (auto& [id, handle] : callbacks)
+            wrenReleaseHandle(vm, handle);
+        callbacks.clear();
         wrenFreeVM(vm);
         vm = nullptr;
     }
@@ -328,13 +445,15 @@ void xs::script::update(double dt)
     }
 }
 
-void xs::script::render()
+void xs::script::render(double alpha)
 {
     XS_PROFILE_FUNCTION();
     if (initialized)
     {
-        wrenEnsureSlots(vm, 1);
+        wrenEnsureSlots(vm, 2);
         wrenSetSlotHandle(vm, 0, game_class);
+        if (render_alpha)
+            wrenSetSlotDouble(vm, 1, alpha);
         wrenCall(vm, render_method);
     }
 }
@@ -415,6 +534,12 @@ size_t xs::script::get_bytes_allocated()
 	return vm ? vm->bytesAllocated : 0;
 }
 
+void xs::script::set_random_seed(uint32_t seed)
+{
+	fixed_seed = true;
+	random_seed = seed;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // 
 //										All xs API
@@ -801,6 +926,56 @@ static void render_load_image(WrenVM* vm)
     callFunction_returnType_args<int, string>(vm, xs::render::load_image);
 }
 
+// Keep a handle to a Wren function so it can be called later, from async work
+static int store_callback(WrenVM* vm, int slot)
+{
+    const int id = next_callback_id++;
+    callbacks[id] = wrenGetSlotHandle(vm, slot);
+    return id;
+}
+
+// Call a stored Wren function once with a number and release it. The callback
+// is gone if the VM was reloaded in the meantime, in which case nothing happens.
+static void call_callback(int callback_id, double value)
+{
+    auto it = callbacks.find(callback_id);
+    if (it == callbacks.end())
+        return;
+
+    WrenHandle* fn = it->second;
+    callbacks.erase(it);
+    if (initialized && call_method)
+    {
+        wrenEnsureSlots(vm, 2);
+        wrenSetSlotHandle(vm, 0, fn);
+        wrenSetSlotDouble(vm, 1, value);
+        wrenCall(vm, call_method);
+    }
+    wrenReleaseHandle(vm, fn);
+}
+
+static void render_load_image_async(WrenVM* vm)
+{
+    auto file = wrenGetParameter<string>(vm, 1);
+    auto image_id = xs::render::load_image_async(file);
+    wrenSetSlotDouble(vm, 0, image_id);
+}
+
+static void render_load_image_async_callback(WrenVM* vm)
+{
+    auto file = wrenGetParameter<string>(vm, 1);
+    const int callback_id = store_callback(vm, 2);
+    auto image_id = xs::render::load_image_async(file, [callback_id](int id) {
+        call_callback(callback_id, id);
+    });
+    wrenSetSlotDouble(vm, 0, image_id);
+}
+
+static void render_is_image_ready(WrenVM* vm)
+{
+    callFunction_returnType_args<bool, int>(vm, xs::render::is_image_ready);
+}
+
 static void render_load_shape(WrenVM* vm)
 {
     auto shape_path = wrenGetParameter<string>(vm, 1);
@@ -1008,9 +1183,33 @@ void simple_audio_load(WrenVM* vm)
     callFunction_returnType_args<int, string>(vm, xs::simple_audio::load);
 }
 
+void simple_audio_load_all(WrenVM* vm)
+{
+    auto filenames = wrenGetListParameter<string>(vm, 1);
+    auto ids = xs::simple_audio::load_many(filenames);
+
+    wrenEnsureSlots(vm, 2);
+    wrenSetSlotNewList(vm, 0);
+    for (int id : ids)
+    {
+        wrenSetSlotDouble(vm, 1, (double)id);
+        wrenInsertInList(vm, 0, -1, 1);
+    }
+}
+
+void simple_audio_load_stream(WrenVM* vm)
+{
+    callFunction_returnType_args<int, string>(vm, xs::simple_audio::load_stream);
+}
+
 void simple_audio_play(WrenVM* vm)
 {
-    callFunction_returnType_args<double, int, double>(vm, xs::simple_audio::play);
+    callFunction_returnType_args<double, int, double>(vm, static_cast<int(*)(int, double)>(xs::simple_audio::play));
+}
+
+void simple_audio_play_panned(WrenVM* vm)
+{
+    callFunction_returnType_args<double, int, double, double, double>(vm, static_cast<int(*)(int, double, double, double)>(xs::simple_audio::play));
 }
 
 void simple_audio_set_volume(WrenVM* vm)
@@ -1018,6 +1217,21 @@ void simple_audio_set_volume(WrenVM* vm)
     callFunction_args<int, double>(vm, xs::simple_audio::set_volume);
 }
 
+void simple_audio_set_max_voices(WrenVM* vm)
+{
+    callFunction_args<int, int>(vm, xs::simple_audio::set_max_voices);
+}
+
+void simple_audio_set_priority(WrenVM* vm)
+{
+    callFunction_args<int, int>(vm, xs::simple_audio::set_priority);
+}
+
+void simple_audio_set_pan(WrenVM* vm)
+{
+    callFunction_args<int, double>(vm, xs::simple_audio::set_pan);
+}
+
 void simple_audio_get_volume(WrenVM* vm)
 {
     callFunction_returnType_args<double, int>(vm, xs::simple_audio::get_volume);
@@ -1042,24 +1256,44 @@ void simple_audio_is_playing(WrenVM* vm)
 // Data
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+// The getters take either a name or a handle from Data.handle(name)
+template <typename T>
+void data_get(
+    WrenVM* vm,
+    T(*by_name)(const string&, xs::data::type),
+    T(*by_key)(xs::data::key, xs::data::type))
+{
+    auto type = wrenGetParameter<xs::data::type>(vm, 2);
+    if (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM)
+        wrenSetReturnValue<T>(vm, by_key((xs::data::key)wrenGetSlotDouble(vm, 1), type));
+    else
+        wrenSetReturnValue<T>(vm, by_name(wrenGetParameter<string>(vm, 1), type));
+}
+
+void data_handle(WrenVM* vm)
+{
+    auto name = wrenGetParameter<string>(vm, 1);
+    wrenSetSlotDouble(vm, 0, (double)xs::data::intern(name));
+}
+
 void data_get_number(WrenVM* vm)
 {
-    callFunction_returnType_args<double, string, xs::data::type>(vm, xs::data::get_number);
+    data_get<double>(vm, xs::data::get_number, xs::data::get_number);
 }
 
 void data_get_bool(WrenVM* vm)
 {
-    callFunction_returnType_args<bool, string, xs::data::type>(vm, xs::data::get_bool);
+    data_get<bool>(vm, xs::data::get_bool, xs::data::get_bool);
 }
 
 void data_get_color(WrenVM* vm)
 {
-    callFunction_returnType_args<uint32_t, string, xs::data::type>(vm, xs::data::get_color);
+    data_get<uint32_t>(vm, xs::data::get_color, xs::data::get_color);
 }
 
 void data_get_string(WrenVM* vm)
 {
-    callFunction_returnType_args<string, string, xs::data::type>(vm, xs::data::get_string);
+    data_get<string>(vm, xs::data::get_string, xs::data::get_string);
 }
 
 void data_set_bool(WrenVM* vm)
@@ -1082,13 +1316,23 @@ void data_set_string(WrenVM* vm)
     callFunction_args<string, string, xs::data::type>(vm, xs::data::set_string);
 }
 
+void data_save(WrenVM* vm)
+{
+    callFunction_args<xs::data::type>(vm, xs::data::save_async);
+}
+
+void data_is_saving(WrenVM* vm)
+{
+    callFunction_returnType<bool>(vm, xs::data::saving);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // File
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void file_read(WrenVM* vm)
 {
-    callFunction_returnType_args<string, string>(vm, xs::fileio::read_text_file);
+    callFunction_returnType_args<string, string>(vm, static_cast<string(*)(const string&)>(xs::fileio::read_text_file));
 }
 
 void file_write(WrenVM* vm)
@@ -1098,105 +1342,264 @@ void file_write(WrenVM* vm)
 
 void file_exists(WrenVM* vm)
 {
-    callFunction_returnType_args<bool, string>(vm, xs::fileio::exists);
+    callFunction_returnType_args<bool, string>(vm, static_cast<bool(*)(const string&)>(xs::fileio::exists));
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // JSON
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Recursively converts nlohmann::json to Wren value
-void json_to_wren(WrenVM* vm, int slot, const nlohmann::json& j)
+// Builds Wren values straight from the parser's tokens, without a json document in between.
+// The open lists and maps sit in slots 0 to depth - 1 (the outermost one in slot 0, where
+// the result goes), the value that is added to the innermost one goes in the slot above,
+// and the slot above that holds its key.
+struct json_to_wren
+{
+    using json = nlohmann::json;
+
+    WrenVM* vm;
+    int depth = 0;
+    vector<bool> is_map;        // For each open container
+    vector<std::string> keys;   // Key of the next value, for each open map
+    std::string error;
+
+    explicit json_to_wren(WrenVM* vm) : vm(vm) { wrenEnsureSlots(vm, 2); }
+
+    bool null() { wrenSetSlotNull(vm, depth); return add(); }
+    bool boolean(bool val) { wrenSetSlotBool(vm, depth, val); return add(); }
+    bool number_integer(json::number_integer_t val) { wrenSetSlotDouble(vm, depth, (double)val); return add(); }
+    bool number_unsigned(json::number_unsigned_t val) { wrenSetSlotDouble(vm, depth, (double)val); return add(); }
+    bool number_float(json::number_float_t val, const json::string_t&) { wrenSetSlotDouble(vm, depth, val); return add(); }
+    bool string(json::string_t& val) { wrenSetSlotBytes(vm, depth, val.data(), val.size()); return add(); }
+    bool binary(json::binary_t&) { wrenSetSlotNull(vm, depth); return add(); }
+
+    bool start_object(size_t) { wrenSetSlotNewMap(vm, depth); return open(true); }
+    bool start_array(size_t) { wrenSetSlotNewList(vm, depth); return open(false); }
+    bool key(json::string_t& val) { keys.back().swap(val); return true; }
+    bool end_object() { return close(); }
+    bool end_array() { return close(); }
+
+    bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& ex)
+    {
+        error = ex.what();
+        return false;
+    }
+
+    bool open(bool map)
+    {
+        is_map.push_back(map);
+        keys.emplace_back();
+        depth++;
+        wrenEnsureSlots(vm, depth + 2);
+        return true;
+    }
+
+    bool close()
+    {
+        depth--;
+        is_map.pop_back();
+        keys.pop_back();
+        return add();
+    }
+
+    // Put the value in slot depth into the innermost open container
+    bool add()
+    {
+        if (depth == 0)
+            return true;
+
+        const int parent = depth - 1;
+        if (is_map[parent])
+        {
+            const auto& k = keys[parent];
+            wrenSetSlotBytes(vm, depth + 1, k.data(), k.size());
+            wrenSetMapValue(vm, parent, depth + 1, depth);
+        }
+        else
+        {
+            wrenInsertInList(vm, parent, -1, depth);
+        }
+        return true;
+    }
+};
+
+// Parse json text into slot 0, or null and the error message when it is not valid
+bool json_parse_to_wren(WrenVM* vm, const char* begin, const char* end, string& error)
 {
-    if (j.is_null())
+    json_to_wren builder(vm);
+    bool ok = false;
+    try
     {
-        wrenSetSlotNull(vm, slot);
+        ok = nlohmann::json::sax_parse(begin, end, &builder);
+        error = builder.error;
     }
-    else if (j.is_boolean())
+    catch (const std::exception& e)
     {
-        wrenSetSlotBool(vm, slot, j.get<bool>());
+        error = e.what();
     }
-    else if (j.is_number())
+
+    if (!ok)
+        wrenSetSlotNull(vm, 0);
+    return ok;
+}
+
+// Reused between calls, so writing a large file doesn't grow a new buffer every time
+string json_buffer;
+
+void json_append_number(string& out, double d)
+{
+    if (!std::isfinite(d))
     {
-        wrenSetSlotDouble(vm, slot, j.get<double>());
+        out += "null";
+        return;
     }
-    else if (j.is_string())
+
+    // Whole numbers are written the way Wren prints them, without a fraction
+    char buf[32];
+    if (d == std::floor(d) && std::abs(d) < 9007199254740992.0)
     {
-        wrenSetSlotString(vm, slot, j.get<string>().c_str());
+        snprintf(buf, sizeof(buf), "%.0f", d);
     }
-    else if (j.is_array())
+    else
     {
-        wrenSetSlotNewList(vm, slot);
-        int elemSlot = slot + 1;
-        wrenEnsureSlots(vm, elemSlot + 1);
-        for (size_t i = 0; i < j.size(); i++)
+        // Shortest form that reads back as the same number
+        for (int precision = 15; precision <= 17; precision++)
         {
-            json_to_wren(vm, elemSlot, j[i]);
-            wrenInsertInList(vm, slot, -1, elemSlot);
+            snprintf(buf, sizeof(buf), "%.*g", precision, d);
+            if (strtod(buf, nullptr) == d)
+                break;
         }
     }
-    else if (j.is_object())
+    out += buf;
+}
+
+void json_append_string(string& out, const char* str, size_t length)
+{
+    out += '"';
+    for (size_t i = 0; i < length; i++)
     {
-        wrenSetSlotNewMap(vm, slot);
-        int keySlot = slot + 1;
-        int valueSlot = slot + 2;
-        wrenEnsureSlots(vm, valueSlot + 1);
-        for (auto it = j.begin(); it != j.end(); ++it)
+        const unsigned char c = (unsigned char)str[i];
+        switch (c)
         {
-            wrenSetSlotString(vm, keySlot, it.key().c_str());
-            json_to_wren(vm, valueSlot, it.value());
-            wrenSetMapValue(vm, slot, keySlot, valueSlot);
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (c < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+            {
+                out += (char)c;
+            }
         }
     }
+    out += '"';
 }
 
-// Recursively converts Wren value to nlohmann::json
-nlohmann::json wren_to_json(WrenVM* vm, int slot)
+// Writes a Wren value as json (indented by four spaces), reading the lists and maps
+// directly from the VM. Nothing is allocated in the VM, so the values can't be collected.
+void wren_to_json(string& out, Value value, int depth)
 {
-    WrenType type = wrenGetSlotType(vm, slot);
+    // Deeper than this is almost certainly a list or map that contains itself
+    constexpr int c_max_depth = 512;
+    if (depth > c_max_depth)
+        throw std::runtime_error("value is nested too deep (does it contain itself?)");
 
-    switch (type)
+    auto indent = [&out](int level) { out.append((size_t)level * 4, ' '); };
+
+    if (IS_NULL(value))
     {
-    case WREN_TYPE_NULL:
-        return nlohmann::json(nullptr);
-    case WREN_TYPE_BOOL:
-        return nlohmann::json(wrenGetSlotBool(vm, slot));
-    case WREN_TYPE_NUM:
-        return nlohmann::json(wrenGetSlotDouble(vm, slot));
-    case WREN_TYPE_STRING:
-        return nlohmann::json(string(wrenGetSlotString(vm, slot)));
-    case WREN_TYPE_LIST:
+        out += "null";
+    }
+    else if (IS_BOOL(value))
     {
-        nlohmann::json arr = nlohmann::json::array();
-        int count = wrenGetListCount(vm, slot);
-        int elemSlot = slot + 1;
-        wrenEnsureSlots(vm, elemSlot + 1);
-        for (int i = 0; i < count; i++)
+        out += AS_BOOL(value) ? "true" : "false";
+    }
+    else if (IS_NUM(value))
+    {
+        json_append_number(out, AS_NUM(value));
+    }
+    else if (IS_STRING(value))
+    {
+        json_append_string(out, AS_STRING(value)->value, AS_STRING(value)->length);
+    }
+    else if (IS_LIST(value))
+    {
+        const ObjList* list = AS_LIST(value);
+        if (list->elements.count == 0)
         {
-            wrenGetListElement(vm, slot, i, elemSlot);
-            arr.push_back(wren_to_json(vm, elemSlot));
+            out += "[]";
+            return;
         }
-        return arr;
+
+        out += "[\n";
+        for (int i = 0; i < list->elements.count; i++)
+        {
+            indent(depth + 1);
+            wren_to_json(out, list->elements.data[i], depth + 1);
+            out += i + 1 < list->elements.count ? ",\n" : "\n";
+        }
+        indent(depth);
+        out += ']';
     }
-    case WREN_TYPE_MAP:
+    else if (IS_MAP(value))
     {
-        nlohmann::json obj = nlohmann::json::object();
-        int count = wrenGetMapCount(vm, slot);
-        // Get map keys as a list
-        int keysSlot = slot + 1;
-        int keySlot = slot + 2;
-        int valueSlot = slot + 3;
-        wrenEnsureSlots(vm, valueSlot + 1);
-
-        // Iterate through the map - we need to get keys first
-        // Unfortunately Wren doesn't have a direct way to iterate maps,
-        // so we'll need to use a workaround by calling the keys method
-        // For now, return empty object for maps (limitation)
-        xs::log::warn("JSON stringify: Map conversion not fully supported");
-        return obj;
+        // Json keys are strings, other value types are written the way they print.
+        // Keys are sorted, so saving the same map gives the same file.
+        const ObjMap* map = AS_MAP(value);
+        vector<pair<string, Value>> entries;
+        entries.reserve(map->count);
+        for (uint32_t i = 0; i < map->capacity; i++)
+        {
+            const MapEntry& entry = map->entries[i];
+            if (IS_UNDEFINED(entry.key))
+                continue;
+
+            string key;
+            if (IS_STRING(entry.key))
+                key.assign(AS_STRING(entry.key)->value, AS_STRING(entry.key)->length);
+            else if (IS_NUM(entry.key))
+                json_append_number(key, AS_NUM(entry.key));
+            else if (IS_BOOL(entry.key))
+                key = AS_BOOL(entry.key) ? "true" : "false";
+            else if (IS_NULL(entry.key))
+                key = "null";
+            else
+                continue;
+            entries.emplace_back(std::move(key), entry.value);
+        }
+
+        if (entries.empty())
+        {
+            out += "{}";
+            return;
+        }
+
+        sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        out += "{\n";
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            indent(depth + 1);
+            json_append_string(out, entries[i].first.data(), entries[i].first.size());
+            out += ": ";
+            wren_to_json(out, entries[i].second, depth + 1);
+            out += i + 1 < entries.size() ? ",\n" : "\n";
+        }
+        indent(depth);
+        out += '}';
     }
-    default:
-        return nlohmann::json(nullptr);
+    else
+    {
+        out += "null";
     }
 }
 
@@ -1218,32 +1621,27 @@ void json_load(WrenVM* vm)
         return;
     }
 
-    try
-    {
-        nlohmann::json j = nlohmann::json::parse(content);
-        json_to_wren(vm, 0, j);
-    }
-    catch (const nlohmann::json::parse_error& e)
-    {
-        xs::log::error("JSON parse error in '{}': {}", path, e.what());
-        wrenSetSlotNull(vm, 0);
-    }
+    string error;
+    if (!json_parse_to_wren(vm, content.data(), content.data() + content.size(), error))
+        xs::log::error("JSON parse error in '{}': {}", path, error);
 }
 
 void json_parse(WrenVM* vm)
 {
-    auto content = wrenGetParameter<string>(vm, 1);
+    if (!checkType(vm, 1, WREN_TYPE_STRING, __func__))
+        return;
 
-    try
-    {
-        nlohmann::json j = nlohmann::json::parse(content);
-        json_to_wren(vm, 0, j);
-    }
-    catch (const nlohmann::json::parse_error& e)
-    {
-        xs::log::error("JSON parse error: {}", e.what());
-        wrenSetSlotNull(vm, 0);
-    }
+    // Parse the Wren string in place. Slot 1 gets reused while building the result,
+    // so the handle keeps the string alive until the parse is done.
+    int length = 0;
+    const char* content = wrenGetSlotBytes(vm, 1, &length);
+    WrenHandle* source = wrenGetSlotHandle(vm, 1);
+
+    string error;
+    if (!json_parse_to_wren(vm, content, content + length, error))
+        xs::log::error("JSON parse error: {}", error);
+
+    wrenReleaseHandle(vm, source);
 }
 
 void json_save(WrenVM* vm)
@@ -1253,9 +1651,9 @@ void json_save(WrenVM* vm)
 
     try
     {
-        nlohmann::json j = wren_to_json(vm, 2);
-        auto content = j.dump(4); // Pretty print with 4 spaces
-        bool success = xs::fileio::write_text_file(content, path);
+        json_buffer.clear();
+        wren_to_json(json_buffer, vm->apiStack[2], 0);
+        bool success = xs::fileio::write_text_file(json_buffer, path);
         wrenSetSlotBool(vm, 0, success);
     }
     catch (const std::exception& e)
@@ -1270,9 +1668,9 @@ void json_stringify(WrenVM* vm)
     // Slot 1 contains the value to stringify
     try
     {
-        nlohmann::json j = wren_to_json(vm, 1);
-        auto content = j.dump(4); // Pretty print with 4 spaces
-        wrenSetSlotString(vm, 0, content.c_str());
+        json_buffer.clear();
+        wren_to_json(json_buffer, vm->apiStack[1], 0);
+        wrenSetSlotBytes(vm, 0, json_buffer.data(), json_buffer.size());
     }
     catch (const std::exception& e)
     {
@@ -1318,6 +1716,11 @@ void profiler_end_section(WrenVM* vm)
 	callFunction_args<string>(vm, xs::profiler::end_section);
 }
 
+void profiler_counter(WrenVM* vm)
+{
+	callFunction_args<string, double>(vm, xs::profiler::counter);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Inspector (ImGui bindings) - Forward declarations
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1494,6 +1897,9 @@ void xs::script::bind_api()
 
     // Render
     bind("xs/core", "Render", true, "loadImage(_)", render_load_image);
+    bind("xs/core", "Render", true, "loadImageAsync(_)", render_load_image_async);
+    bind("xs/core", "Render", true, "loadImageAsync(_,_)", render_load_image_async_callback);
+    bind("xs/core", "Render", true, "isReady(_)", render_is_image_ready);
     bind("xs/core", "Render", true, "loadShape(_)", render_load_shape);
     bind("xs/core", "Render", true, "getImageWidth(_)", render_get_image_width);
     bind("xs/core", "Render", true, "getImageHeight(_)", render_get_image_height);
@@ -1536,14 +1942,21 @@ void xs::script::bind_api()
 
     // SimpleAudio
     bind("xs/core", "SimpleAudio", true, "load(_)", simple_audio_load);
+    bind("xs/core", "SimpleAudio", true, "loadAll(_)", simple_audio_load_all);
+    bind("xs/core", "SimpleAudio", true, "loadStream(_)", simple_audio_load_stream);
     bind("xs/core", "SimpleAudio", true, "play(_,_)", simple_audio_play);
+    bind("xs/core", "SimpleAudio", true, "play(_,_,_,_)", simple_audio_play_panned);
+    bind("xs/core", "SimpleAudio", true, "setMaxVoices(_,_)", simple_audio_set_max_voices);
+    bind("xs/core", "SimpleAudio", true, "setPriority(_,_)", simple_audio_set_priority);
     bind("xs/core", "SimpleAudio", true, "setVolume(_,_)", simple_audio_set_volume);
+    bind("xs/core", "SimpleAudio", true, "setPan(_,_)", simple_audio_set_pan);
     bind("xs/core", "SimpleAudio", true, "getVolume(_)", simple_audio_get_volume);
     bind("xs/core", "SimpleAudio", true, "stop(_)", simple_audio_stop);
     bind("xs/core", "SimpleAudio", true, "stopAll()", simple_audio_stop_all);
     bind("xs/core", "SimpleAudio", true, "isPlaying(_)", simple_audio_is_playing);
 
     // Data
+    bind("xs/core", "Data", true, "handle(_)", data_handle);
     bind("xs/core", "Data", true, "getNumber(_,_)", data_get_number);
     bind("xs/core", "Data", true, "getColor(_,_)", data_get_color);
     bind("xs/core", "Data", true, "getBool(_,_)", data_get_bool);
@@ -1552,6 +1965,8 @@ void xs::script::bind_api()
     bind("xs/core", "Data", true, "setColor(_,_,_)", data_set_color);
     bind("xs/core", "Data", true, "setBool(_,_,_)", data_set_bool);
     bind("xs/core", "Data", true, "setString(_,_,_)", data_set_string);
+    bind("xs/core", "Data", true, "save(_)", data_save);
+    bind("xs/core", "Data", true, "isSaving()", data_is_saving);
 
     // File
     bind("xs/core", "File", true, "read(_)", file_read);
@@ -1573,6 +1988,7 @@ void xs::script::bind_api()
     // Profiler
     bind("xs/core", "Profiler", true, "begin(_)", profiler_begin_section);
     bind("xs/core", "Profiler", true, "end(_)", profiler_end_section);
+    bind("xs/core", "Profiler", true, "counter(_,_)", profiler_counter);
 
     // Inspector
     bind("xs/core", "Inspector", true, "text(_)", inspector_text);
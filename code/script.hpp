@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 typedef struct WrenVM WrenVM;
@@ -11,7 +12,8 @@ namespace xs::script
 	void initialize();
 	void shutdown();
 	void update(double dt);
-	void render();
+	/// Call Game.render, with how far the game is into the next fixed update if it takes one argument
+	void render(double alpha = 1.0);
 	void ec_inspect(const std::string& filter);
 	bool is_module_loaded(const std::string& module);
 	bool has_error();
@@ -29,4 +31,7 @@ namespace xs::script
 		WrenForeignMethodFn allocate_fn,
 		WrenFinalizerFn finalize_fn = NULL);
     size_t get_bytes_allocated();
+
+	/// Seed Random.new() from this instead of the clock, so runs can be repeated (call before configure)
+	void set_random_seed(uint32_t seed);
 }
@@ -1,5 +1,6 @@
 #include "device.hpp"
 #include "device_sdl.hpp"
+#include "xs.hpp"
 #include "log.hpp"
 #include "opengl/opengl.hpp"
 #include "configuration.hpp"
@@ -41,10 +42,16 @@ void log_opengl_version_info()
 
 void device::initialize()
 {
+	// Headless runs use SDL's offscreen driver, which renders into an EGL pbuffer with no
+	// window on screen, so they work without a display (bench --replay on a build server)
+	const bool headless = xs::is_headless();
+	if (headless)
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+
 	// Switch to SDL
 	if (SDL_Init(SDL_INIT_VIDEO) != true)
 	{
-		log::critical("SDL init failed");
+		log::critical("SDL init failed: {}", SDL_GetError());
 		assert(false);
 		exit(EXIT_FAILURE);
 	}
@@ -80,12 +87,12 @@ void device::initialize()
 	internal::height = configuration::height() * configuration::multiplier();
 #endif
 
-	// Create window
+	// Create window (offscreen and hidden when headless, rendering still goes through it)
 	internal::window = SDL_CreateWindow(
 		configuration::title().c_str(),
 		internal::width,
 		internal::height,
-		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | (headless ? SDL_WINDOW_HIDDEN : 0));
 	
 	if (!internal::window)
 	{
@@ -97,8 +104,14 @@ void device::initialize()
 
 	// Set OpenGL context
 	internal::context = SDL_GL_CreateContext(internal::window);
+	if (!internal::context)
+	{
+		log::critical("OpenGL context could not be created: {}", SDL_GetError());
+		SDL_Quit();
+		assert(false);
+		exit(EXIT_FAILURE);
+	}
 	SDL_GL_MakeCurrent(internal::window, internal::context);
-	SDL_GL_SetSwapInterval(1);
 
 	// OpenGL init here	
 	if (!gladLoadGL())
@@ -111,6 +124,9 @@ void device::initialize()
 	log_opengl_version_info();
 	init_debug_messages();
 
+	if (headless)
+		return;
+
 	SDL_ShowWindow(internal::window);
 
 	// Set application icon
@@ -159,8 +175,9 @@ void device::poll_events()
 			{
 				internal::width = event.window.data1;
 				internal::height = event.window.data2;
-				// Update OpenGL viewport to match new window size
-				glViewport(0, 0, internal::width, internal::height);
+				// Update OpenGL viewport to match new window size (the render thread sets its own)
+				if (SDL_GL_GetCurrentContext() == internal::context)
+					glViewport(0, 0, internal::width, internal::height);
 			}
 			break;
 			// Window focus event
@@ -201,6 +218,21 @@ SDL_GLContextState* xs::device::get_context()
 	return internal::context;	
 }
 
+void xs::device::acquire_context()
+{
+	SDL_GL_MakeCurrent(internal::window, internal::context);
+}
+
+void xs::device::release_context()
+{
+	SDL_GL_MakeCurrent(internal::window, nullptr);
+}
+
+bool xs::device::set_swap_interval(int interval)
+{
+	return SDL_GL_SetSwapInterval(interval);
+}
+
 int xs::device::get_width()
 {
 	return internal::width;
@@ -1,7 +1,11 @@
 #include "input.hpp"
 #include <cassert>
 #include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <unordered_map>
+#include <vector>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_gamepad.h>
 
@@ -66,6 +70,23 @@ void update_mouse();
 int get_usb_scancode(int key);
 Data* data = nullptr;
 
+// Recordings start with a header (magic, version, seed), followed by one entry per frame:
+// the dt, the keys that went up or down, the mouse and the default gamepad (if there is one)
+constexpr char c_recording_magic[4] = { 'X', 'S', 'I', 'R' };
+constexpr uint32_t c_recording_version = 1;
+static_assert(SDL_GAMEPAD_BUTTON_COUNT <= 32, "Gamepad buttons are recorded as 32 bits");
+
+ofstream record_file;
+int recorded_frames = 0;
+vector<char> replay_data;
+size_t replay_cursor = 0;
+int replayed_frames = 0;
+
+void record_frame(double dt);
+bool replay_frame();
+template<typename T> void write(const T& value);
+template<typename T> bool read(T& value);
+
 }
 
 // Dummy implementation for the PC platform (for now)
@@ -76,17 +97,95 @@ void xs::input::initialize()
 }
 void xs::input::shutdown()
 {	
+	if (record_file.is_open())
+	{
+		record_file.close();
+		log::info("Recorded {} frames of input", recorded_frames);
+	}
+
 	for (auto& j : data->gamepads)
-		SDL_CloseGamepad(j.second.sdl_pad);
+		if (j.second.sdl_pad)
+			SDL_CloseGamepad(j.second.sdl_pad);
 	SDL_QuitSubSystem(SDL_INIT_GAMEPAD);
 	delete data;
 }
 
 void xs::input::update(double dt)
 {
-	update_all_gamepads();
-	update_keyboard();
-	update_mouse();
+	// A replay stands in for the devices until it runs out
+	if (!replaying() || !replay_frame())
+	{
+		update_all_gamepads();
+		update_keyboard();
+		update_mouse();
+	}
+
+	if (record_file.is_open())
+		record_frame(dt);
+}
+
+bool xs::input::start_recording(const std::string& path, uint32_t seed)
+{
+	record_file.open(path, ios::binary | ios::trunc);
+	if (!record_file)
+	{
+		log::error("Could not open {} to record input", path);
+		return false;
+	}
+
+	record_file.write(c_recording_magic, sizeof(c_recording_magic));
+	write(c_recording_version);
+	write(seed);
+	recorded_frames = 0;
+	log::info("Recording input to {}", path);
+	return true;
+}
+
+bool xs::input::start_replay(const std::string& path, uint32_t& seed)
+{
+	ifstream file(path, ios::binary);
+	if (!file)
+	{
+		log::error("Could not open input recording {}", path);
+		return false;
+	}
+
+	replay_data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	replay_cursor = 0;
+	replayed_frames = 0;
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	if (replay_data.size() < sizeof(magic) ||
+		memcmp(replay_data.data(), c_recording_magic, sizeof(magic)) != 0)
+	{
+		log::error("{} is not an input recording", path);
+		replay_data.clear();
+		return false;
+	}
+	replay_cursor = sizeof(magic);
+	if (!read(version) || version != c_recording_version || !read(seed))
+	{
+		log::error("Input recording {} has an unsupported version", path);
+		replay_data.clear();
+		return false;
+	}
+
+	log::info("Replaying input from {}", path);
+	return true;
+}
+
+bool xs::input::replaying()
+{
+	return replay_cursor < replay_data.size();
+}
+
+double xs::input::replay_dt()
+{
+	double dt = 0.0;
+	if (replaying() && replay_cursor + sizeof(dt) <= replay_data.size())
+		memcpy(&dt, &replay_data[replay_cursor], sizeof(dt));
+	return dt;
 }
 
 double xs::input::get_mouse_x()
@@ -277,6 +376,114 @@ void xs::input::update_mouse()
 	data->mouse_wheel = 0.0f;
 }
 
+void xs::input::record_frame(double dt)
+{
+	write(dt);
+
+	// Most frames no key changes, so only the changes are kept
+	vector<uint16_t> changed;
+	for (int i = 0; i < SDL_SCANCODE_COUNT; i++)
+		if (data->keys_down[i] != data->prev_keys_down[i])
+			changed.push_back((uint16_t)i);
+	write((uint16_t)changed.size());
+	for (auto scancode : changed)
+		write(scancode);
+
+	write(data->mouse_x);
+	write(data->mouse_y);
+	write(data->mouse_wheel);
+	uint8_t mouse_buttons = 0;
+	for (int i = 0; i < 5; i++)
+		if (data->mouse_buttons[i])
+			mouse_buttons |= 1 << i;
+	write(mouse_buttons);
+
+	auto gamepad = get_default_gamepad();
+	write((uint8_t)(gamepad != nullptr));
+	if (gamepad)
+	{
+		uint32_t buttons = 0;
+		for (int i = 0; i < SDL_GAMEPAD_BUTTON_COUNT; i++)
+			if (gamepad->gamepad.buttons[i])
+				buttons |= 1u << i;
+		write(buttons);
+		for (int i = 0; i < SDL_GAMEPAD_AXIS_COUNT; i++)
+			write(gamepad->gamepad.axes[i]);
+	}
+
+	recorded_frames++;
+}
+
+// Puts the next recorded frame in place of the device state, false when the recording is done
+bool xs::input::replay_frame()
+{
+	double dt = 0.0;
+	uint16_t changed = 0;
+	bool ok = read(dt) && read(changed);
+
+	memcpy(data->prev_keys_down, data->keys_down, sizeof(data->keys_down));
+	for (uint16_t i = 0; ok && i < changed; i++)
+	{
+		uint16_t scancode = 0;
+		ok = read(scancode);
+		if (ok && scancode < SDL_SCANCODE_COUNT)
+			data->keys_down[scancode] = !data->keys_down[scancode];
+	}
+
+	memcpy(data->prev_mouse_buttons, data->mouse_buttons, sizeof(data->mouse_buttons));
+	uint8_t mouse_buttons = 0;
+	ok = ok && read(data->mouse_x) && read(data->mouse_y) && read(data->mouse_wheel) && read(mouse_buttons);
+	for (int i = 0; i < 5; i++)
+		data->mouse_buttons[i] = (mouse_buttons & (1 << i)) != 0;
+
+	uint8_t has_gamepad = 0;
+	ok = ok && read(has_gamepad);
+	if (ok && has_gamepad)
+	{
+		auto& entry = data->gamepads[0];
+		entry.prev_gamepad = entry.gamepad;
+		uint32_t buttons = 0;
+		ok = read(buttons);
+		for (int i = 0; i < SDL_GAMEPAD_BUTTON_COUNT; i++)
+			entry.gamepad.buttons[i] = (buttons & (1u << i)) != 0;
+		for (int i = 0; ok && i < SDL_GAMEPAD_AXIS_COUNT; i++)
+			ok = read(entry.gamepad.axes[i]);
+	}
+	else
+	{
+		data->gamepads.erase(0);
+	}
+
+	if (!ok)
+	{
+		log::warn("Input recording ends in the middle of a frame, stopping the replay");
+		replay_data.clear();
+		replay_cursor = 0;
+		return false;
+	}
+
+	replayed_frames++;
+	if (!replaying())
+		log::info("Replay finished after {} frames", replayed_frames);
+	return true;
+}
+
+template<typename T>
+void xs::input::write(const T& value)
+{
+	record_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool xs::input::read(T& value)
+{
+	if (replay_cursor + sizeof(T) > replay_data.size())
+		return false;
+	memcpy(&value, &replay_data[replay_cursor], sizeof(T));
+	replay_cursor += sizeof(T);
+	return true;
+}
+
 int xs::input::get_usb_scancode(int key)
 {
 	int scanout = -1;
@@ -115,6 +115,28 @@ void update(double dt)
 	}
 }
 
+// Offline rendering needs the software mixer (simple_audio.cpp with XS_SIMPLE_AUDIO_SDL3)
+void initialize_offline(int sample_rate)
+{
+	log::error("SimpleAudio offline rendering is not available in this build");
+}
+
+int render(float* out, int frames)
+{
+	return 0;
+}
+
+bool render_to_file(const std::string& filename, double seconds)
+{
+	return false;
+}
+
+double benchmark(int voices, double seconds, const std::string& output)
+{
+	log::error("SimpleAudio benchmark is not available in this build");
+	return -1.0;
+}
+
 int load(const std::string& filename)
 {
 	if (!data)
@@ -145,6 +167,22 @@ int load(const std::string& filename)
 	return audio_id;
 }
 
+std::vector<int> load_many(const std::vector<std::string>& filenames)
+{
+	// SDL_LoadWAV has nothing worth spreading over threads
+	std::vector<int> ids;
+	ids.reserve(filenames.size());
+	for (const auto& filename : filenames)
+		ids.push_back(load(filename));
+	return ids;
+}
+
+int load_stream(const std::string& filename)
+{
+	// SDL_LoadWAV only, nothing to stream
+	return load(filename);
+}
+
 int play(int audio_id, double volume)
 {
 	if (!data || !data->device)
@@ -217,6 +255,12 @@ int play(int audio_id, double volume)
 	return channel_id;
 }
 
+int play(int audio_id, double volume, double pan, double delay)
+{
+	// No mixer here, so pan and delay are not supported
+	return play(audio_id, volume);
+}
+
 void set_volume(int channel_id, double volume)
 {
 	if (!data || channel_id < 0 || channel_id >= static_cast<int>(data->channels.size()))
@@ -229,6 +273,21 @@ void set_volume(int channel_id, double volume)
 		SDL_SetAudioStreamGain(channel.stream, static_cast<float>(volume));
 }
 
+void set_max_voices(int audio_id, int max_voices)
+{
+	// One SDL stream per channel, no voice limits
+}
+
+void set_priority(int audio_id, int priority)
+{
+	// One SDL stream per channel, no voice limits
+}
+
+void set_pan(int channel_id, double pan)
+{
+	// One SDL stream per channel, there is no pan control
+}
+
 double get_volume(int channel_id)
 {
 	if (!data || channel_id < 0 || channel_id >= static_cast<int>(data->channels.size()))
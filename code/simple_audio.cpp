@@ -3,10 +3,17 @@
 #include "simple_audio.hpp"
 #include "log.hpp"
 #include "fileio.hpp"
+#include "mixer.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <SDL3/SDL.h>
 
 // Audio decoding libraries
@@ -21,31 +28,528 @@
 namespace xs::simple_audio
 {
 
-// Audio data structure
+// Audio data structure, samples are decoded to float at the mixer rate at load time
 struct AudioData
 {
-	std::vector<uint8_t> buffer;
-	SDL_AudioSpec spec;
+	std::vector<float> samples;		// Interleaved, one or two channels
+	int channels = 0;
+	int sample_rate = 0;			// Rate of the file, the samples are at the mixer rate
+	uint64_t frames = 0;
+
+	// Streamed audio is read from the file and decoded while playing
+	bool streamed = false;
+	std::string ext;
+	std::string filename;
+
+	// Voice limiting
+	int max_voices = 8;		// Voices of this sound that can play at once
+	int priority = 0;		// Higher priority sounds can take voices from lower ones
 };
 
-// Playing channel structure
-struct Channel
+// Incremental decoder for a streamed voice, reading the file a chunk at a time.
+// Output is resampled to the mixer rate when the file has a different rate.
+// Decoders are pooled and keep their buffers when closed, so playing allocates
+// only what the codec itself needs.
+struct Decoder
 {
-	SDL_AudioStream* stream = nullptr;
+	fileio::stream file;
+	stb_vorbis* vorbis = nullptr;
+	drflac* flac = nullptr;
+	int channels = 0;
+	int sample_rate = 0;
+	std::vector<float> decoded;		// Chunk at the file rate, only used when resampling
+	std::vector<float> scratch;		// Chunk at the mixer rate
+	mixer::resampler resampler;
+	int resampler_channels = 0;		// What the resampler was made for
+	int resampler_rate = 0;
+	int resampler_target = 0;
+	bool resampling = false;
+	bool flushed = false;
+
+	// Vorbis is fed from a window of the file and hands out a frame at a time
+	std::vector<unsigned char> input;
+	size_t input_start = 0;
+	size_t input_end = 0;
+	float** frame = nullptr;
+	int frame_samples = 0;
+	int frame_offset = 0;
+
+	Decoder() = default;
+	Decoder(const Decoder&) = delete;
+	Decoder& operator=(const Decoder&) = delete;
+	~Decoder();
+
+	bool open(const AudioData& audio);
+	void close();
+	bool is_open() const { return vorbis || flac; }
+
+	// Decode the next chunk into scratch, returns the number of frames (0 at the end)
+	int read();
+
+	// Decode up to frames at the file rate
+	int decode(float* out, int frames);
+
+	// Read more of the file into the vorbis input, false when nothing was added
+	bool fill();
+	int decode_vorbis(float* out, int frames);
+};
+
+// A voice in the mixer. Voices are preallocated, playing a sound takes a free one.
+struct Voice
+{
+	const AudioData* audio = nullptr;
+	Decoder* decoder = nullptr;			// Only for streamed audio, from the decoder pool
+	int channel_id = -1;
 	int audio_id = -1;
-	double volume = 1.0;
-	bool playing = false;
+	float volume = 1.0f;
+	float pan = 0.0f;
+	uint64_t start_frame = 0;			// Mixer frame to start on, for sample accurate starts
+	uint32_t generation = 0;			// Bumped every time the voice is reused
+	bool active = false;
+
+	// Read position in the source
+	uint64_t position = 0;				// Whole frames into the samples (or decoder scratch)
+	uint64_t available = 0;				// Frames in the decoder scratch
+	bool source_done = false;
 };
 
 // Internal state
 namespace internal
 {
+	constexpr int c_max_voices = 64;
+
+	// Channel ids are the voice index in the low bits and the voice generation above,
+	// so an id of a voice that has been reused no longer matches
+	constexpr int c_voice_index_bits = 8;
+	constexpr int c_voice_index_mask = (1 << c_voice_index_bits) - 1;
+	static_assert(c_max_voices <= (1 << c_voice_index_bits));
+
+	// Plays of the same sound closer together than this are dropped
+	constexpr double c_retrigger_window = 0.03;
+
+	// Frames mixed per block, the device callback can ask for more and gets several blocks
+	constexpr int c_mix_block = 512;
+
+	// Frames decoded at a time for streamed voices
+	constexpr int c_stream_chunk_frames = 4096;
+
+	// Bytes of an OGG file held for decoding, at least an OGG page
+	constexpr size_t c_stream_input_bytes = 64 * 1024;
+
 	std::unordered_map<int, std::shared_ptr<AudioData>> audio_files;
-	std::unordered_map<int, std::unique_ptr<Channel>> channels;
+	std::array<Voice, c_max_voices> voices;
+	std::array<Decoder, c_max_voices + 1> decoders;	// One more than voices, so a play always finds one (main thread only)
+	SDL_AudioStream* stream = nullptr;		// The one stream feeding the device
 	SDL_AudioDeviceID device_id = 0;
-	int next_audio_id = 1;
-	int next_channel_id = 1;
+	int sample_rate = 48000;				// Mixer (and device) rate
+	uint64_t mix_clock = 0;					// Frames mixed so far
 	bool initialized = false;
+	bool offline = false;					// No device, the mixer runs from render()
+
+	// Scratch buffer for the mixer, allocated once
+	std::vector<float> mix_buffer;
+
+	std::string get_extension(const std::string& filename);
+	std::shared_ptr<AudioData> decode(const std::string& filename);
+	bool write_wav(const std::vector<float>& samples, const std::string& filename);
+	Voice* find_voice(int channel_id);
+	Voice* take_voice(int audio_id, const AudioData& audio, float volume);
+	Decoder* take_decoder();
+	void release_decoder(Voice& voice);		// Main thread, with the mixer locked
+	void mix(float* out, int frames);
+	void SDLCALL mix_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+
+	// Keeps the mixer from running while the voices are changed
+	struct mixer_lock
+	{
+		mixer_lock() { if (stream) SDL_LockAudioStream(stream); }
+		~mixer_lock() { if (stream) SDL_UnlockAudioStream(stream); }
+	};
+}
+
+Decoder::~Decoder()
+{
+	close();
+}
+
+bool Decoder::open(const AudioData& audio)
+{
+	close();
+	file = fileio::open_stream(audio.filename);
+	if (!file.is_open())
+		return false;
+
+	flushed = false;
+	input_start = 0;
+	input_end = 0;
+	frame = nullptr;
+	frame_samples = 0;
+	frame_offset = 0;
+
+	if (audio.ext == "ogg")
+	{
+		// The headers have to fit in the input window
+		input.resize(internal::c_stream_input_bytes);
+		while (!vorbis)
+		{
+			int used = 0;
+			int error = 0;
+			vorbis = stb_vorbis_open_pushdata(
+				input.data() + input_start,
+				static_cast<int>(input_end - input_start),
+				&used,
+				&error,
+				nullptr);
+			if (vorbis)
+				input_start += used;
+			else if (error != VORBIS_need_more_data || !fill())
+				break;
+		}
+		if (!vorbis)
+		{
+			close();
+			return false;
+		}
+		stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+		channels = std::min(info.channels, 2);
+		sample_rate = static_cast<int>(info.sample_rate);
+	}
+	else if (audio.ext == "flac")
+	{
+		auto on_read = [](void* user, void* out, size_t bytes) -> size_t {
+			return static_cast<Decoder*>(user)->file.read(static_cast<std::byte*>(out), bytes);
+		};
+		auto on_seek = [](void* user, int offset, drflac_seek_origin origin) -> drflac_bool32 {
+			auto& f = static_cast<Decoder*>(user)->file;
+			const int64_t base =
+				origin == DRFLAC_SEEK_SET ? 0 :
+				origin == DRFLAC_SEEK_CUR ? static_cast<int64_t>(f.tell()) :
+				static_cast<int64_t>(f.size());
+			const int64_t target = base + offset;
+			if (target < 0 || target > static_cast<int64_t>(f.size()))
+				return DRFLAC_FALSE;
+			return f.seek(static_cast<uint64_t>(target)) ? DRFLAC_TRUE : DRFLAC_FALSE;
+		};
+		auto on_tell = [](void* user, drflac_int64* cursor) -> drflac_bool32 {
+			*cursor = static_cast<drflac_int64>(static_cast<Decoder*>(user)->file.tell());
+			return DRFLAC_TRUE;
+		};
+		flac = drflac_open(on_read, on_seek, on_tell, this, nullptr);
+		if (!flac || flac->channels > 2)
+		{
+			close();
+			return false;
+		}
+		channels = flac->channels;
+		sample_rate = static_cast<int>(flac->sampleRate);
+	}
+	else
+	{
+		close();
+		return false;
+	}
+
+	// Everything the audio thread uses is allocated here, and kept for the next open
+	const int chunk = internal::c_stream_chunk_frames;
+	resampling = sample_rate != internal::sample_rate;
+	if (resampling)
+	{
+		if (resampler_channels != channels || resampler_rate != sample_rate || resampler_target != internal::sample_rate)
+		{
+			resampler = mixer::resampler(channels, sample_rate, internal::sample_rate);
+			resampler.reserve(chunk);
+			resampler_channels = channels;
+			resampler_rate = sample_rate;
+			resampler_target = internal::sample_rate;
+		}
+		else
+		{
+			resampler.reset();
+		}
+		decoded.resize(static_cast<size_t>(chunk) * channels);
+		scratch.resize(static_cast<size_t>(resampler.max_output(chunk)) * channels);
+	}
+	else
+	{
+		scratch.resize(static_cast<size_t>(chunk) * channels);
+	}
+	return true;
+}
+
+void Decoder::close()
+{
+	if (vorbis)
+		stb_vorbis_close(vorbis);
+	if (flac)
+		drflac_close(flac);
+	vorbis = nullptr;
+	flac = nullptr;
+	file = fileio::stream();
+}
+
+int Decoder::decode(float* out, int frames)
+{
+	if (vorbis)
+		return decode_vorbis(out, frames);
+	if (flac)
+		return static_cast<int>(drflac_read_pcm_frames_f32(flac, frames, out));
+	return 0;
+}
+
+int Decoder::decode_vorbis(float* out, int frames)
+{
+	int written = 0;
+	while (written < frames)
+	{
+		// Hand out what is left of the last frame first
+		if (frame_offset < frame_samples)
+		{
+			const int count = std::min(frames - written, frame_samples - frame_offset);
+			for (int i = 0; i < count; i++)
+				for (int c = 0; c < channels; c++)
+					out[(written + i) * channels + c] = frame[c][frame_offset + i];
+			frame_offset += count;
+			written += count;
+			continue;
+		}
+
+		int samples = 0;
+		const int used = stb_vorbis_decode_frame_pushdata(
+			vorbis,
+			input.data() + input_start,
+			static_cast<int>(input_end - input_start),
+			nullptr,
+			&frame,
+			&samples);
+		frame_samples = samples;
+		frame_offset = 0;
+		if (used == 0 && samples == 0)
+		{
+			// Needs more of the file, or the file is done
+			if (!fill())
+				break;
+			continue;
+		}
+		input_start += used;
+	}
+	return written;
+}
+
+bool Decoder::fill()
+{
+	// Move what is left to the front and read behind it
+	if (input_start > 0)
+	{
+		std::memmove(input.data(), input.data() + input_start, input_end - input_start);
+		input_end -= input_start;
+		input_start = 0;
+	}
+	if (input_end == input.size())
+		return false;
+
+	const size_t count = file.read(reinterpret_cast<std::byte*>(input.data() + input_end), input.size() - input_end);
+	input_end += count;
+	return count > 0;
+}
+
+int Decoder::read()
+{
+	const int chunk = internal::c_stream_chunk_frames;
+	if (!resampling)
+		return decode(scratch.data(), chunk);
+
+	// The resampler holds back frames for its filter, so a chunk can come out empty
+	while (!flushed)
+	{
+		const int frames = decode(decoded.data(), chunk);
+		const int written = frames > 0 ?
+			resampler.process(decoded.data(), frames, scratch.data()) :
+			resampler.flush(scratch.data());
+		flushed = frames == 0;
+		if (written > 0)
+			return written;
+	}
+	return 0;
+}
+
+std::string internal::get_extension(const std::string& filename)
+{
+	std::string ext;
+	size_t dot_pos = filename.find_last_of('.');
+	if (dot_pos != std::string::npos)
+	{
+		ext = filename.substr(dot_pos + 1);
+		// Convert to lowercase
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	}
+	return ext;
+}
+
+Voice* internal::find_voice(int channel_id)
+{
+	if (channel_id < 0)
+		return nullptr;
+
+	auto& voice = voices[channel_id & c_voice_index_mask];
+	if (voice.active && voice.channel_id == channel_id)
+		return &voice;
+	return nullptr;
+}
+
+Decoder* internal::take_decoder()
+{
+	for (auto& decoder : decoders)
+		if (!decoder.is_open())
+			return &decoder;
+	return nullptr;
+}
+
+void internal::release_decoder(Voice& voice)
+{
+	if (voice.decoder)
+		voice.decoder->close();
+	voice.decoder = nullptr;
+}
+
+// Find a voice for a new play of a sound. At its limit the sound replaces its own quietest
+// (then oldest) voice. Under it, takes a free voice, or when the pool is full steals the
+// quietest (then oldest) voice that is not more important.
+Voice* internal::take_voice(int audio_id, const AudioData& audio, float volume)
+{
+	Voice* free_voice = nullptr;
+	Voice* same_sound = nullptr;	// Steal candidate among voices of this sound
+	Voice* any_sound = nullptr;		// Steal candidate among all voices
+	int playing = 0;
+
+	// Quietest first, then the one that started first
+	auto quieter = [](const Voice* a, const Voice* b) {
+		if (!b)
+			return true;
+		if (a->volume != b->volume)
+			return a->volume < b->volume;
+		return a->start_frame < b->start_frame;
+	};
+
+	for (auto& voice : voices)
+	{
+		if (!voice.active)
+		{
+			if (!free_voice)
+				free_voice = &voice;
+			continue;
+		}
+
+		if (voice.audio_id == audio_id)
+		{
+			playing++;
+			if (quieter(&voice, same_sound))
+				same_sound = &voice;
+		}
+
+		if (voice.audio->priority <= audio.priority && quieter(&voice, any_sound))
+			any_sound = &voice;
+	}
+
+	// At the limit for this sound, the new play always replaces one of its own voices
+	if (playing >= audio.max_voices)
+		return same_sound;
+
+	if (free_voice)
+		return free_voice;
+
+	// Pool is full, only steal from sounds that are not more important
+	if (any_sound && (any_sound->audio->priority < audio.priority || any_sound->volume <= volume))
+		return any_sound;
+
+	return nullptr;
+}
+
+// Mix all active voices into an interleaved stereo buffer (runs on the audio thread)
+void internal::mix(float* out, int frames)
+{
+	std::fill_n(out, frames * 2, 0.0f);
+
+	const uint64_t block_start = mix_clock;
+	const uint64_t block_end = mix_clock + frames;
+	for (auto& voice : voices)
+	{
+		if (!voice.active || voice.start_frame >= block_end)
+			continue;
+
+		// Sample accurate start inside this block
+		const int offset = voice.start_frame > block_start ? static_cast<int>(voice.start_frame - block_start) : 0;
+		const int count = frames - offset;
+
+		float gain_left = 0.0f;
+		float gain_right = 0.0f;
+		mixer::pan_gains(voice.volume, voice.pan, gain_left, gain_right);
+
+		// Everything is at the mixer rate, so samples are mixed straight from the
+		// loaded audio (or the decoder chunk for streamed audio)
+		const AudioData& audio = *voice.audio;
+		int mixed = 0;
+		while (mixed < count)
+		{
+			const float* src = nullptr;
+			uint64_t left = 0;
+			if (voice.decoder)
+			{
+				if (voice.position >= voice.available)
+				{
+					voice.available = voice.source_done ? 0 : voice.decoder->read();
+					voice.position = 0;
+					if (voice.available == 0)
+					{
+						voice.source_done = true;
+						break;
+					}
+				}
+				src = voice.decoder->scratch.data();
+				left = voice.available - voice.position;
+			}
+			else
+			{
+				src = audio.samples.data();
+				left = audio.frames - voice.position;
+				if (left == 0)
+					break;
+			}
+
+			src += voice.position * audio.channels;
+			const int length = static_cast<int>(std::min<uint64_t>(left, count - mixed));
+			float* dst = out + (offset + mixed) * 2;
+			if (audio.channels == 2)
+				mixer::mix_stereo(dst, src, length, gain_left, gain_right);
+			else
+				mixer::mix_mono(dst, src, length, gain_left, gain_right);
+			voice.position += length;
+			mixed += length;
+		}
+
+		// Ran out of samples
+		if (mixed < count)
+		{
+			voice.active = false;
+			voice.audio = nullptr;
+		}
+	}
+
+	mix_clock = block_end;
+}
+
+// Called by SDL on the audio thread, with the stream locked
+void SDLCALL internal::mix_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+{
+	XS_MEMORY_TAG(audio);
+	const int frame_size = 2 * static_cast<int>(sizeof(float));
+	int frames = (additional_amount + frame_size - 1) / frame_size;
+	while (frames > 0)
+	{
+		const int count = std::min(frames, c_mix_block);
+		mix(mix_buffer.data(), count);
+		SDL_PutAudioStreamData(stream, mix_buffer.data(), count * frame_size);
+		frames -= count;
+	}
 }
 
 void initialize()
@@ -63,129 +567,260 @@ void initialize()
 		return;
 	}
 
-	// Open the default audio playback device
-	internal::device_id = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, nullptr);
-	if (internal::device_id == 0)
+	// Mix at the rate of the device, so SDL only has to convert the format
+	SDL_AudioSpec spec = {};
+	if (SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, nullptr) && spec.freq > 0)
+		internal::sample_rate = spec.freq;
+	spec.format = SDL_AUDIO_F32;
+	spec.channels = 2;
+	spec.freq = internal::sample_rate;
+
+	// Open the default audio playback device with a single stream that the mixer feeds
+	internal::stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, internal::mix_callback, nullptr);
+	if (!internal::stream)
 	{
 		log::error("Failed to open audio device: {}", SDL_GetError());
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 		return;
 	}
+	internal::device_id = SDL_GetAudioStreamDevice(internal::stream);
+
+	internal::mix_buffer.resize(internal::c_mix_block * 2);
+	internal::mix_clock = 0;
 
 	// Resume the audio device (it starts paused by default)
-	if (!SDL_ResumeAudioDevice(internal::device_id))
+	if (!SDL_ResumeAudioStreamDevice(internal::stream))
 	{
 		log::error("Failed to resume audio device: {}", SDL_GetError());
-		SDL_CloseAudioDevice(internal::device_id);
+		SDL_DestroyAudioStream(internal::stream);
+		internal::stream = nullptr;
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 		return;
 	}
 
 	internal::initialized = true;
-	log::info("SimpleAudio initialized using SDL3");
+	log::info("SimpleAudio initialized using SDL3 ({} Hz, {} voices, {} mixer)",
+		internal::sample_rate, internal::c_max_voices, mixer::simd_name());
 }
 
-void shutdown()
+void initialize_offline(int sample_rate)
 {
-	if (!internal::initialized)
+	if (internal::initialized)
+	{
+		log::warn("SimpleAudio already initialized");
 		return;
+	}
+
+	// Same state as with a device, but nothing pulls from the mixer
+	internal::sample_rate = sample_rate > 0 ? sample_rate : 48000;
+	internal::stream = nullptr;
+	internal::device_id = 0;
+	internal::mix_clock = 0;
+	internal::mix_buffer.resize(internal::c_mix_block * 2);
+	internal::offline = true;
+	internal::initialized = true;
+	log::info("SimpleAudio initialized offline ({} Hz, {} voices, {} mixer)",
+		internal::sample_rate, internal::c_max_voices, mixer::simd_name());
+}
 
-	// Stop all channels and destroy streams
-	for (auto& [id, channel] : internal::channels)
+int render(float* out, int frames)
+{
+	if (!internal::initialized || !internal::offline)
 	{
-		if (channel->stream)
-		{
-			SDL_DestroyAudioStream(channel->stream);
-			channel->stream = nullptr;
-		}
+		log::error("SimpleAudio render is only available offline");
+		return 0;
 	}
-	internal::channels.clear();
-
-	// Clear audio data
-	internal::audio_files.clear();
 
-	// Close audio device
-	if (internal::device_id)
+	// Same blocks as the device callback, so the output matches
+	for (int done = 0; done < frames;)
 	{
-		SDL_CloseAudioDevice(internal::device_id);
-		internal::device_id = 0;
+		const int count = std::min(frames - done, internal::c_mix_block);
+		internal::mix(out + done * 2, count);
+		done += count;
 	}
+	return frames;
+}
 
-	// Quit SDL audio subsystem
-	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+bool render_to_file(const std::string& filename, double seconds)
+{
+	const int frames = static_cast<int>(std::max(0.0, seconds) * internal::sample_rate);
+	std::vector<float> samples(static_cast<size_t>(frames) * 2);
+	if (render(samples.data(), frames) != frames)
+		return false;
+	return internal::write_wav(samples, filename);
+}
 
-	internal::initialized = false;
-	log::info("SimpleAudio shutdown");
+// Write interleaved stereo float samples at the mixer rate as a WAV file
+bool internal::write_wav(const std::vector<float>& samples, const std::string& filename)
+{
+	drwav_data_format format = {};
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+	format.channels = 2;
+	format.sampleRate = static_cast<drwav_uint32>(sample_rate);
+	format.bitsPerSample = 32;
+
+	void* data = nullptr;
+	size_t size = 0;
+	drwav wav;
+	if (!drwav_init_memory_write(&wav, &data, &size, &format, nullptr))
+	{
+		log::error("Failed to write WAV file: {}", filename);
+		return false;
+	}
+	drwav_write_pcm_frames(&wav, samples.size() / 2, samples.data());
+	drwav_uninit(&wav);
+
+	std::vector<std::byte> bytes(size);
+	std::memcpy(bytes.data(), data, size);
+	drwav_free(data, nullptr);
+	return fileio::write_binary_file(bytes, filename);
 }
 
-void update(double dt)
+double benchmark(int voices, double seconds, const std::string& output)
 {
-	if (!internal::initialized)
-		return;
+	// Runs on its own offline mixer, so it can't share one with a device
+	const bool owns_mixer = !internal::initialized;
+	if (owns_mixer)
+		initialize_offline(48000);
+	if (!internal::offline)
+	{
+		log::error("SimpleAudio benchmark needs the offline mixer");
+		return -1.0;
+	}
+
+	voices = std::clamp(voices, 1, internal::c_max_voices);
+	const int rate = internal::sample_rate;
+	const int frames = static_cast<int>(std::max(0.01, seconds) * rate);
 
-	// Clean up finished channels
-	std::vector<int> finished_channels;
-	for (auto& [id, channel] : internal::channels)
+	// Generated tones, a mono and a stereo one, long enough to never run out
+	std::array<AudioData, 2> tones;
+	for (int channels = 1; channels <= 2; channels++)
 	{
-		if (channel->stream && channel->playing)
-		{
-			// Check if the stream has finished playing
-			int queued = SDL_GetAudioStreamQueued(channel->stream);
-			if (queued == 0)
-			{
-				channel->playing = false;
-				finished_channels.push_back(id);
-			}
-		}
+		AudioData& tone = tones[channels - 1];
+		tone.channels = channels;
+		tone.sample_rate = rate;
+		tone.frames = frames;
+		tone.samples.resize(static_cast<size_t>(frames) * channels);
+		for (int i = 0; i < frames; i++)
+			for (int c = 0; c < channels; c++)
+				tone.samples[i * channels + c] = 0.1f * std::sin(static_cast<float>(i) * (0.03f + 0.01f * c));
 	}
 
-	// Remove finished channels
-	for (int id : finished_channels)
+	// Set the game's voices (if any) aside and fill the voices directly, play() would merge
+	// the plays of the same sound. The benchmark voices have no channel id and a newer
+	// generation, so ids handed out before can't reach them.
+	std::array<Voice, internal::c_max_voices> saved_voices;
+	uint64_t saved_clock = 0;
 	{
-		if (internal::channels[id]->stream)
+		internal::mixer_lock lock;
+		saved_voices.swap(internal::voices);
+		saved_clock = internal::mix_clock;
+		for (int i = 0; i < voices; i++)
 		{
-			SDL_DestroyAudioStream(internal::channels[id]->stream);
+			Voice& voice = internal::voices[i];
+			voice.generation = saved_voices[i].generation + 1;
+			voice.channel_id = -1;
+			voice.audio = &tones[i % 2];
+			voice.audio_id = -1;
+			voice.volume = 0.5f;
+			voice.pan = static_cast<float>(i % 3 - 1);
+			voice.start_frame = internal::mix_clock;
+			voice.active = true;
 		}
-		internal::channels.erase(id);
 	}
+
+	std::vector<float> output_samples(static_cast<size_t>(frames) * 2);
+	const auto start = std::chrono::high_resolution_clock::now();
+	render(output_samples.data(), frames);
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	// Put the game's voices back where they were
+	{
+		internal::mixer_lock lock;
+		internal::voices.swap(saved_voices);
+		internal::mix_clock = saved_clock;
+	}
+
+	const double elapsed = std::chrono::duration<double, std::micro>(end - start).count();
+	const double audio_seconds = static_cast<double>(frames) / rate;
+	const double per_voice = elapsed / voices / audio_seconds;
+	log::info("SimpleAudio benchmark: {} voices, {:.2f}s of audio mixed in {:.2f}ms ({} mixer)",
+		voices, audio_seconds, elapsed / 1000.0, mixer::simd_name());
+	log::info("SimpleAudio benchmark: {:.2f}us per voice per second of audio, {:.0f}x real time",
+		per_voice, audio_seconds * 1e6 / elapsed);
+
+	if (!output.empty() && !internal::write_wav(output_samples, output))
+		log::error("Failed to write benchmark mix to {}", output);
+
+	if (owns_mixer)
+		shutdown();
+	return per_voice;
 }
 
-int load(const std::string& filename)
+void shutdown()
 {
 	if (!internal::initialized)
-	{
-		log::error("SimpleAudio not initialized");
-		return -1;
-	}
+		return;
 
-	// Check if already loaded
-	int hash = static_cast<int>(std::hash<std::string>{}(filename));
-	if (internal::audio_files.find(hash) != internal::audio_files.end())
+	// Closes the device as well
+	if (internal::stream)
+		SDL_DestroyAudioStream(internal::stream);
+	internal::stream = nullptr;
+	internal::device_id = 0;
+
+	for (auto& voice : internal::voices)
+		voice = Voice();
+	for (auto& decoder : internal::decoders)
+		decoder.close();
+
+	// Clear audio data
+	internal::audio_files.clear();
+
+	// Quit SDL audio subsystem
+	if (!internal::offline)
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+
+	internal::initialized = false;
+	internal::offline = false;
+	log::info("SimpleAudio shutdown");
+}
+
+void update(double dt)
+{
+	XS_MEMORY_TAG(audio);
+	if (!internal::initialized)
+		return;
+
+	// Voices that ran out are freed by the mixer, only decoders are released here
+	// so the audio thread never frees memory
+	internal::mixer_lock lock;
+	for (auto& voice : internal::voices)
 	{
-		return hash;
+		if (!voice.active && voice.decoder)
+			internal::release_decoder(voice);
 	}
+}
 
+// Read and decode a file to float at the mixer rate. Only touches its own data, so
+// several files can be decoded at once on the loader threads.
+std::shared_ptr<AudioData> internal::decode(const std::string& filename)
+{
+	XS_MEMORY_TAG(audio);
 	// Read the audio file
 	auto file_data = fileio::read_binary_file(filename);
 	if (file_data.empty())
 	{
 		log::error("Failed to read audio file: {}", filename);
-		return -1;
+		return nullptr;
 	}
 
 	// Detect file format by extension
-	std::string ext;
-	size_t dot_pos = filename.find_last_of('.');
-	if (dot_pos != std::string::npos)
-	{
-		ext = filename.substr(dot_pos + 1);
-		// Convert to lowercase
-		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-	}
+	std::string ext = get_extension(filename);
 
 	auto audio_data = std::make_shared<AudioData>();
-	
-	// Decode based on format
+
+	// Decode based on format, straight to float
 	if (ext == "wav")
 	{
 		// Load WAV using dr_wav
@@ -193,38 +828,21 @@ int load(const std::string& filename)
 		if (!drwav_init_memory(&wav, file_data.data(), file_data.size(), nullptr))
 		{
 			log::error("Failed to load WAV file: {}", filename);
-			return -1;
+			return nullptr;
 		}
 
-		// Setup SDL_AudioSpec
-		audio_data->spec.format = (wav.bitsPerSample == 16) ? SDL_AUDIO_S16 : 
-		                          (wav.bitsPerSample == 32) ? SDL_AUDIO_S32 : SDL_AUDIO_U8;
-		audio_data->spec.channels = wav.channels;
-		audio_data->spec.freq = wav.sampleRate;
-
-		// Read all samples
-		size_t total_samples = wav.totalPCMFrameCount * wav.channels;
-		if (wav.bitsPerSample == 16)
-		{
-			std::vector<int16_t> samples(total_samples);
-			drwav_read_pcm_frames_s16(&wav, wav.totalPCMFrameCount, samples.data());
-			audio_data->buffer.resize(total_samples * sizeof(int16_t));
-			memcpy(audio_data->buffer.data(), samples.data(), audio_data->buffer.size());
-		}
-		else if (wav.bitsPerSample == 32)
-		{
-			std::vector<int32_t> samples(total_samples);
-			drwav_read_pcm_frames_s32(&wav, wav.totalPCMFrameCount, samples.data());
-			audio_data->buffer.resize(total_samples * sizeof(int32_t));
-			memcpy(audio_data->buffer.data(), samples.data(), audio_data->buffer.size());
-		}
-		else
+		if (wav.channels > 2)
 		{
-			std::vector<uint8_t> samples(total_samples);
-			drwav_read_pcm_frames(&wav, wav.totalPCMFrameCount, samples.data());
-			audio_data->buffer = samples;
+			log::error("WAV file {} has {} channels, only mono and stereo are supported", filename, wav.channels);
+			drwav_uninit(&wav);
+			return nullptr;
 		}
 
+		audio_data->channels = wav.channels;
+		audio_data->sample_rate = wav.sampleRate;
+		audio_data->samples.resize(wav.totalPCMFrameCount * wav.channels);
+		audio_data->frames = drwav_read_pcm_frames_f32(&wav, wav.totalPCMFrameCount, audio_data->samples.data());
+
 		drwav_uninit(&wav);
 	}
 	else if (ext == "flac")
@@ -234,21 +852,20 @@ int load(const std::string& filename)
 		if (!flac)
 		{
 			log::error("Failed to load FLAC file: {}", filename);
-			return -1;
+			return nullptr;
 		}
 
-		// Setup SDL_AudioSpec
-		audio_data->spec.format = (flac->bitsPerSample == 16) ? SDL_AUDIO_S16 : SDL_AUDIO_S32;
-		audio_data->spec.channels = flac->channels;
-		audio_data->spec.freq = flac->sampleRate;
+		if (flac->channels > 2)
+		{
+			log::error("FLAC file {} has {} channels, only mono and stereo are supported", filename, flac->channels);
+			drflac_close(flac);
+			return nullptr;
+		}
 
-		// Read all samples as 16-bit
-		size_t total_samples = flac->totalPCMFrameCount * flac->channels;
-		std::vector<int16_t> samples(total_samples);
-		drflac_read_pcm_frames_s16(flac, flac->totalPCMFrameCount, samples.data());
-		
-		audio_data->buffer.resize(total_samples * sizeof(int16_t));
-		memcpy(audio_data->buffer.data(), samples.data(), audio_data->buffer.size());
+		audio_data->channels = flac->channels;
+		audio_data->sample_rate = flac->sampleRate;
+		audio_data->samples.resize(flac->totalPCMFrameCount * flac->channels);
+		audio_data->frames = drflac_read_pcm_frames_f32(flac, flac->totalPCMFrameCount, audio_data->samples.data());
 
 		drflac_close(flac);
 	}
@@ -266,50 +883,188 @@ int load(const std::string& filename)
 		if (!vorbis)
 		{
 			log::error("Failed to load OGG file: {} (error: {})", filename, error);
-			return -1;
+			return nullptr;
 		}
 
 		stb_vorbis_info info = stb_vorbis_get_info(vorbis);
-		
-		// Setup SDL_AudioSpec
-		audio_data->spec.format = SDL_AUDIO_S16;
-		audio_data->spec.channels = info.channels;
-		audio_data->spec.freq = info.sample_rate;
 
-		// Get total samples
+		// stb_vorbis mixes down anything with more than two channels
+		audio_data->channels = std::min(info.channels, 2);
+		audio_data->sample_rate = info.sample_rate;
+
 		int total_frames = stb_vorbis_stream_length_in_samples(vorbis);
-		size_t total_samples = total_frames * info.channels;
-		
-		std::vector<int16_t> samples(total_samples);
-		int samples_read = stb_vorbis_get_samples_short_interleaved(
-			vorbis, 
-			info.channels, 
-			samples.data(), 
-			static_cast<int>(total_samples)
+		audio_data->samples.resize(static_cast<size_t>(total_frames) * audio_data->channels);
+		audio_data->frames = stb_vorbis_get_samples_float_interleaved(
+			vorbis,
+			audio_data->channels,
+			audio_data->samples.data(),
+			static_cast<int>(audio_data->samples.size())
 		);
 
-		audio_data->buffer.resize(samples_read * info.channels * sizeof(int16_t));
-		memcpy(audio_data->buffer.data(), samples.data(), audio_data->buffer.size());
-
 		stb_vorbis_close(vorbis);
 	}
 	else
 	{
 		log::error("Unsupported audio format: {} (supported: WAV, FLAC, OGG)", ext);
+		return nullptr;
+	}
+
+	audio_data->samples.resize(audio_data->frames * audio_data->channels);
+
+	// Convert once here, so the mixer never has to
+	if (audio_data->sample_rate != sample_rate)
+	{
+		audio_data->samples = mixer::resample(
+			audio_data->samples,
+			audio_data->channels,
+			audio_data->sample_rate,
+			sample_rate);
+		audio_data->frames = audio_data->samples.size() / audio_data->channels;
+	}
+
+#ifdef LOG_AUDIO
+	log::info("Loaded audio file: {} (format: {}, {}Hz, {} channels)",
+	          filename, ext, audio_data->sample_rate, audio_data->channels);
+#endif
+
+	return audio_data;
+}
+
+
+int load(const std::string& filename)
+{
+	if (!internal::initialized)
+	{
+		log::error("SimpleAudio not initialized");
 		return -1;
 	}
 
+	// Check if already loaded
+	int hash = static_cast<int>(std::hash<std::string>{}(filename));
+	if (internal::audio_files.find(hash) != internal::audio_files.end())
+	{
+		return hash;
+	}
+
+	auto audio_data = internal::decode(filename);
+	if (!audio_data)
+		return -1;
+
+	internal::audio_files[hash] = audio_data;
+	return hash;
+}
+
+std::vector<int> load_many(const std::vector<std::string>& filenames)
+{
+	std::vector<int> ids(filenames.size(), -1);
+	if (!internal::initialized)
+	{
+		log::error("SimpleAudio not initialized");
+		return ids;
+	}
+
+	// Each new file gets a slot that one job decodes into
+	std::vector<std::shared_ptr<AudioData>> decoded(filenames.size());
+	std::unordered_map<int, size_t> queued;
+	std::vector<size_t> to_decode;
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		const int hash = static_cast<int>(std::hash<std::string>{}(filenames[i]));
+		if (internal::audio_files.find(hash) != internal::audio_files.end())
+		{
+			ids[i] = hash;
+			continue;
+		}
+
+		// Same file more than once in the list
+		if (!queued.emplace(hash, i).second)
+			continue;
+
+		to_decode.push_back(i);
+	}
+
+	// Decoding is done on the workers, but the ids are needed now
+	jobs::parallel_for(0, static_cast<int>(to_decode.size()), [&](int i) {
+		const size_t index = to_decode[i];
+		decoded[index] = internal::decode(filenames[index]);
+	}, 1, "xs::simple_audio::decode");
+
+	for (const auto& [hash, index] : queued)
+	{
+		if (decoded[index])
+			internal::audio_files[hash] = decoded[index];
+	}
+
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		const int hash = static_cast<int>(std::hash<std::string>{}(filenames[i]));
+		if (internal::audio_files.find(hash) != internal::audio_files.end())
+			ids[i] = hash;
+	}
+
+	return ids;
+}
+
+int load_stream(const std::string& filename)
+{
+	XS_MEMORY_TAG(audio);
+	if (!internal::initialized)
+	{
+		log::error("SimpleAudio not initialized");
+		return -1;
+	}
+
+	// Check if already loaded
+	int hash = static_cast<int>(std::hash<std::string>{}(filename));
+	if (internal::audio_files.find(hash) != internal::audio_files.end())
+	{
+		return hash;
+	}
+
+	// WAV is not compressed, so there is nothing to gain from streaming it
+	std::string ext = internal::get_extension(filename);
+	if (ext != "ogg" && ext != "flac")
+	{
+		log::warn("Streaming is only supported for FLAC and OGG, loading {} fully", filename);
+		return load(filename);
+	}
+
+	auto audio_data = std::make_shared<AudioData>();
+	audio_data->streamed = true;
+	audio_data->ext = ext;
+	audio_data->filename = filename;
+
+	// Open once to check the file and get the format
+	Decoder decoder;
+	if (!decoder.open(*audio_data))
+	{
+		log::error("Failed to load {} file: {}", ext, filename);
+		return -1;
+	}
+	audio_data->channels = decoder.channels;
+	audio_data->sample_rate = decoder.sample_rate;
+	const uint64_t file_size = decoder.file.size();
+
+	// Music, one at a time and not replaced by sound effects
+	audio_data->max_voices = 1;
+	audio_data->priority = 1;
+
 	internal::audio_files[hash] = audio_data;
 
 #ifdef LOG_AUDIO
-	log::info("Loaded audio file: {} (ID: {}, format: {}, {}Hz, {} channels)", 
-	          filename, hash, ext, audio_data->spec.freq, audio_data->spec.channels);
+	log::info("Loaded streamed audio file: {} (ID: {}, format: {}, {}Hz, {} channels, {} bytes)",
+	          filename, hash, ext, audio_data->sample_rate, audio_data->channels, file_size);
 #endif
-	
+
 	return hash;
 }
-	
+
 int play(int audio_id, double volume)
+{
+	return play(audio_id, volume, 0.0, 0.0);
+}
+
+int play(int audio_id, double volume, double pan, double delay)
 {
 	if (!internal::initialized)
 	{
@@ -325,58 +1080,92 @@ int play(int audio_id, double volume)
 		return -1;
 	}
 
-	auto& audio_data = it->second;
+	const AudioData& audio_data = *it->second;
 
-	// Create an audio stream
-	SDL_AudioStream* stream = SDL_CreateAudioStream(&audio_data->spec, &audio_data->spec);
-	if (!stream)
+	// Streamed audio needs its own decoder, open it before touching the mixer
+	Decoder* decoder = nullptr;
+	if (audio_data.streamed)
 	{
-		log::error("Failed to create audio stream: {}", SDL_GetError());
-		return -1;
+		decoder = internal::take_decoder();
+		if (!decoder || !decoder->open(audio_data))
+		{
+			log::error("Failed to start streaming audio ID {}", audio_id);
+			return -1;
+		}
 	}
 
-	// Bind the stream to the audio device
-	if (!SDL_BindAudioStream(internal::device_id, stream))
-	{
-		log::error("Failed to bind audio stream: {}", SDL_GetError());
-		SDL_DestroyAudioStream(stream);
-		return -1;
-	}
+	internal::mixer_lock lock;
+
+	const float gain = static_cast<float>(std::clamp(volume, 0.0, 1.0));
+	const uint64_t start_frame = internal::mix_clock + static_cast<uint64_t>(std::max(0.0, delay) * internal::sample_rate);
 
-	// Set volume (clamp to 0.0 - 1.0)
-	float sdl_volume = static_cast<float>(std::max(0.0, std::min(1.0, volume)));
-	if (!SDL_SetAudioStreamGain(stream, sdl_volume))
+	// Throttle the same sound being started many times in a row (every bullet in a frame
+	// playing the same hit sound), the earlier play covers it
+	const auto window = static_cast<uint64_t>(internal::c_retrigger_window * internal::sample_rate);
+	for (auto& v : internal::voices)
 	{
-		log::warn("Failed to set audio stream gain: {}", SDL_GetError());
+		if (v.active && v.audio_id == audio_id &&
+			v.start_frame + window > start_frame && start_frame + window > v.start_frame)
+		{
+			if (decoder)
+				decoder->close();
+			return v.channel_id;
+		}
 	}
 
-	// Queue the audio data
-	if (!SDL_PutAudioStreamData(stream, audio_data->buffer.data(), (int)audio_data->buffer.size()))
+	Voice* voice = internal::take_voice(audio_id, audio_data, gain);
+	if (!voice)
 	{
-		log::error("Failed to queue audio data: {}", SDL_GetError());
-		SDL_DestroyAudioStream(stream);
+#ifdef LOG_AUDIO
+		log::warn("No voice to play audio ID {}", audio_id);
+#endif
+		if (decoder)
+			decoder->close();
 		return -1;
 	}
 
-	// Flush the stream to start playback
-	if (!SDL_FlushAudioStream(stream))
+	// Reset everything but the generation, so old channel ids stop matching
+	const uint32_t generation = voice->generation + 1;
+	const int index = static_cast<int>(voice - internal::voices.data());
+	internal::release_decoder(*voice);
+	*voice = Voice();
+	voice->generation = generation;
+	voice->channel_id = static_cast<int>(((generation & 0x7FFFFF) << internal::c_voice_index_bits) | index);
+	voice->audio = &audio_data;
+	voice->decoder = decoder;
+	voice->audio_id = audio_id;
+	voice->volume = gain;
+	voice->pan = static_cast<float>(std::clamp(pan, -1.0, 1.0));
+	voice->start_frame = start_frame;
+	voice->active = true;
+
+	return voice->channel_id;
+}
+
+void set_max_voices(int audio_id, int max_voices)
+{
+	auto it = internal::audio_files.find(audio_id);
+	if (it == internal::audio_files.end())
 	{
-		log::error("Failed to flush audio stream: {}", SDL_GetError());
-		SDL_DestroyAudioStream(stream);
-		return -1;
+		log::error("Audio ID {} not found", audio_id);
+		return;
 	}
 
-	// Create and store the channel
-	int channel_id = internal::next_channel_id++;
-	auto channel = std::make_unique<Channel>();
-	channel->stream = stream;
-	channel->audio_id = audio_id;
-	channel->volume = volume;
-	channel->playing = true;
+	internal::mixer_lock lock;
+	it->second->max_voices = std::clamp(max_voices, 1, internal::c_max_voices);
+}
 
-	internal::channels[channel_id] = std::move(channel);
+void set_priority(int audio_id, int priority)
+{
+	auto it = internal::audio_files.find(audio_id);
+	if (it == internal::audio_files.end())
+	{
+		log::error("Audio ID {} not found", audio_id);
+		return;
+	}
 
-	return channel_id;
+	internal::mixer_lock lock;
+	it->second->priority = priority;
 }
 
 void set_volume(int channel_id, double volume)
@@ -384,22 +1173,32 @@ void set_volume(int channel_id, double volume)
 	if (!internal::initialized)
 		return;
 
-	auto it = internal::channels.find(channel_id);
-	if (it == internal::channels.end() || !it->second->stream)
+	internal::mixer_lock lock;
+	auto voice = internal::find_voice(channel_id);
+	if (!voice)
 	{
 		log::warn("Channel {} not found", channel_id);
 		return;
 	}
 
 	// Clamp volume to 0.0 - 1.0
-	volume = std::max(0.0, std::min(1.0, volume));
-	it->second->volume = volume;
+	voice->volume = static_cast<float>(std::clamp(volume, 0.0, 1.0));
+}
+
+void set_pan(int channel_id, double pan)
+{
+	if (!internal::initialized)
+		return;
 
-	float sdl_volume = static_cast<float>(volume);
-	if (!SDL_SetAudioStreamGain(it->second->stream, sdl_volume))
+	internal::mixer_lock lock;
+	auto voice = internal::find_voice(channel_id);
+	if (!voice)
 	{
-		log::warn("Failed to set audio stream gain: {}", SDL_GetError());
+		log::warn("Channel {} not found", channel_id);
+		return;
 	}
+
+	voice->pan = static_cast<float>(std::clamp(pan, -1.0, 1.0));
 }
 
 double get_volume(int channel_id)
@@ -407,13 +1206,14 @@ double get_volume(int channel_id)
 	if (!internal::initialized)
 		return -1.0;
 
-	auto it = internal::channels.find(channel_id);
-	if (it == internal::channels.end())
+	internal::mixer_lock lock;
+	auto voice = internal::find_voice(channel_id);
+	if (!voice)
 	{
 		return -1.0;
 	}
 
-	return it->second->volume;
+	return voice->volume;
 }
 
 void stop(int channel_id)
@@ -421,18 +1221,14 @@ void stop(int channel_id)
 	if (!internal::initialized)
 		return;
 
-	auto it = internal::channels.find(channel_id);
-	if (it == internal::channels.end())
+	internal::mixer_lock lock;
+	auto voice = internal::find_voice(channel_id);
+	if (!voice)
 		return;
 
-	if (it->second->stream)
-	{
-		SDL_DestroyAudioStream(it->second->stream);
-		it->second->stream = nullptr;
-	}
-
-	it->second->playing = false;
-	internal::channels.erase(channel_id);
+	voice->active = false;
+	voice->audio = nullptr;
+	internal::release_decoder(*voice);
 }
 
 void stop_all()
@@ -440,17 +1236,13 @@ void stop_all()
 	if (!internal::initialized)
 		return;
 
-	for (auto& [id, channel] : internal::channels)
+	internal::mixer_lock lock;
+	for (auto& voice : internal::voices)
 	{
-		if (channel->stream)
-		{
-			SDL_DestroyAudioStream(channel->stream);
-			channel->stream = nullptr;
-		}
-		channel->playing = false;
+		voice.active = false;
+		voice.audio = nullptr;
+		internal::release_decoder(voice);
 	}
-
-	internal::channels.clear();
 }
 
 bool is_playing(int channel_id)
@@ -458,11 +1250,8 @@ bool is_playing(int channel_id)
 	if (!internal::initialized)
 		return false;
 
-	auto it = internal::channels.find(channel_id);
-	if (it == internal::channels.end())
-		return false;
-
-	return it->second->playing;
+	internal::mixer_lock lock;
+	return internal::find_voice(channel_id) != nullptr;
 }
 
 }
@@ -488,23 +1277,79 @@ namespace xs::simple_audio
 		// Null implementation
 	}
 
+	void initialize_offline(int sample_rate)
+	{
+		// Null implementation
+	}
+
+	int render(float* out, int frames)
+	{
+		// Null implementation
+		return 0;
+	}
+
+	bool render_to_file(const std::string& filename, double seconds)
+	{
+		// Null implementation
+		return false;
+	}
+
+	double benchmark(int voices, double seconds, const std::string& output)
+	{
+		// Null implementation
+		return -1.0;
+	}
+
 	int load(const std::string& filename)
 	{
 		// Null implementation
 		return -1;
 	}
 
+	int load_stream(const std::string& filename)
+	{
+		// Null implementation
+		return -1;
+	}
+
+	std::vector<int> load_many(const std::vector<std::string>& filenames)
+	{
+		// Null implementation
+		return std::vector<int>(filenames.size(), -1);
+	}
+
 	int play(int audio_id, double volume)
 	{
 		// Null implementation
 		return -1;
 	}
 
+	int play(int audio_id, double volume, double pan, double delay)
+	{
+		// Null implementation
+		return -1;
+	}
+
+	void set_max_voices(int audio_id, int max_voices)
+	{
+		// Null implementation
+	}
+
+	void set_priority(int audio_id, int priority)
+	{
+		// Null implementation
+	}
+
 	void set_volume(int channel_id, double volume)
 	{
 		// Null implementation
 	}
 
+	void set_pan(int channel_id, double pan)
+	{
+		// Null implementation
+	}
+
 	double get_volume(int channel_id)
 	{
 		// Null implementation
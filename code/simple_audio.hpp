@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 
 namespace xs::simple_audio
 {
@@ -12,19 +13,63 @@ namespace xs::simple_audio
 	/// Update the audio system (called once per frame)
 	void update(double dt);
 
+	/// Initialize without an audio device, for tests and benchmarks. The mixer only
+	/// runs when render is called, so the output does not depend on timing.
+	void initialize_offline(int sample_rate);
+
+	/// Mix the next frames into out (interleaved stereo float), offline only
+	/// Returns the number of frames written
+	int render(float* out, int frames);
+
+	/// Mix the next seconds of audio into a 32 bit float WAV file, offline only
+	bool render_to_file(const std::string& filename, double seconds);
+
+	/// Mix a number of voices offline and log how long it took, optionally writing the mix to a WAV file.
+	/// Playing voices are set aside for the run and restored afterwards
+	/// Returns the mixing cost in microseconds per voice per second of audio, or -1 if not available
+	double benchmark(int voices, double seconds, const std::string& output = "");
+
 	/// Load an audio file (WAV, FLAC, or OGG format)
 	/// Returns an audio ID that can be used to play the sound, or -1 on error
 	int load(const std::string& filename);
 
+	/// Load a batch of audio files, decoding them in parallel on the job system workers
+	/// Blocks until all are loaded. Returns an audio ID per file, -1 for files that failed
+	std::vector<int> load_many(const std::vector<std::string>& filenames);
+
+	/// Load a music file (FLAC or OGG) for streaming. It is read from the file and decoded
+	/// while playing, a chunk at a time. WAV files are loaded fully instead.
+	/// Returns an audio ID that can be used to play the sound, or -1 on error
+	int load_stream(const std::string& filename);
+
 	/// Play a loaded audio file with a specific volume
 	/// Volume range: 0.0 (silent) to 1.0 (full volume)
 	/// Returns a channel ID that can be used to control the sound, or -1 on error
+	/// Channel IDs of sounds that have ended stay invalid, even when their voice is reused
 	int play(int audio_id, double volume);
 
+	/// Play a loaded audio file with a volume, a pan and a delay
+	/// Pan range: -1.0 (left) to 1.0 (right), 0.0 is center
+	/// Delay is in seconds and the start is sample accurate
+	/// Returns a channel ID that can be used to control the sound, or -1 on error
+	int play(int audio_id, double volume, double pan, double delay);
+
+	/// Set how many voices of a loaded audio file can play at once (default 8, streamed 1)
+	/// Playing it past the limit replaces its quietest, then oldest, voice
+	void set_max_voices(int audio_id, int max_voices);
+
+	/// Set the priority of a loaded audio file (default 0, streamed 1)
+	/// When all voices are in use, only voices of sounds with lower or equal priority are taken
+	void set_priority(int audio_id, int priority);
+
 	/// Set the volume of a playing channel
 	/// Volume range: 0.0 (silent) to 1.0 (full volume)
 	void set_volume(int channel_id, double volume);
 
+	/// Set the pan of a playing channel
+	/// Pan range: -1.0 (left) to 1.0 (right), 0.0 is center
+	void set_pan(int channel_id, double pan);
+
 	/// Get the volume of a playing channel
 	/// Returns volume in range 0.0 to 1.0, or -1 if channel doesn't exist
 	double get_volume(int channel_id);
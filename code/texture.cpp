@@ -0,0 +1,175 @@
+#include "texture.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stb/stb_image.h>
+
+using namespace std;
+
+namespace xs::texture::internal
+{
+	// Size of the header on disk, fields are written one by one (no padding)
+	constexpr size_t header_size = 4 + 2 + 1 + 1 + 4 + 4 + 4;
+
+	template<typename T>
+	void write(vector<byte>& buffer, size_t& offset, T value)
+	{
+		memcpy(buffer.data() + offset, &value, sizeof(T));
+		offset += sizeof(T);
+	}
+
+	template<typename T>
+	T read(const vector<byte>& buffer, size_t& offset)
+	{
+		T value;
+		memcpy(&value, buffer.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return value;
+	}
+
+	size_t level_size(int width, int height, format f)
+	{
+		return static_cast<size_t>(width) * height * bytes_per_pixel(f);
+	}
+
+	// Box filter a level down to half size. Odd sizes clamp the last row/column.
+	void downsample(const byte* src, int src_w, int src_h, byte* dst, int dst_w, int dst_h, int bpp)
+	{
+		for (int y = 0; y < dst_h; y++)
+		{
+			const int y0 = std::min(y * 2, src_h - 1);
+			const int y1 = std::min(y * 2 + 1, src_h - 1);
+			for (int x = 0; x < dst_w; x++)
+			{
+				const int x0 = std::min(x * 2, src_w - 1);
+				const int x1 = std::min(x * 2 + 1, src_w - 1);
+				for (int c = 0; c < bpp; c++)
+				{
+					const unsigned sum =
+						(unsigned)src[(y0 * src_w + x0) * bpp + c] +
+						(unsigned)src[(y0 * src_w + x1) * bpp + c] +
+						(unsigned)src[(y1 * src_w + x0) * bpp + c] +
+						(unsigned)src[(y1 * src_w + x1) * bpp + c];
+					dst[(y * dst_w + x) * bpp + c] = static_cast<byte>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+using namespace xs;
+using namespace xs::texture::internal;
+
+int xs::texture::bytes_per_pixel(format f)
+{
+	switch (f)
+	{
+	case format::rgba8: return 4;
+	case format::r8: return 1;
+	}
+	return 0;
+}
+
+bool xs::texture::is_baked(const vector<byte>& buffer)
+{
+	if (buffer.size() < header_size)
+		return false;
+	size_t offset = 0;
+	return internal::read<uint32_t>(buffer, offset) == header::MAGIC_NUMBER;
+}
+
+bool xs::texture::read(const vector<byte>& buffer, view& out)
+{
+	if (!is_baked(buffer))
+		return false;
+
+	size_t offset = 0;
+	header& h = out.info;
+	h.magic = internal::read<uint32_t>(buffer, offset);
+	h.version = internal::read<uint16_t>(buffer, offset);
+	h.pixel_format = internal::read<format>(buffer, offset);
+	h.mip_count = internal::read<uint8_t>(buffer, offset);
+	h.width = internal::read<uint32_t>(buffer, offset);
+	h.height = internal::read<uint32_t>(buffer, offset);
+	h.channels = internal::read<uint32_t>(buffer, offset);
+
+	if (h.version != header::VERSION ||
+		bytes_per_pixel(h.pixel_format) == 0 ||
+		h.mip_count == 0 || h.width == 0 || h.height == 0)
+		return false;
+
+	out.levels.clear();
+	int w = static_cast<int>(h.width);
+	int hh = static_cast<int>(h.height);
+	for (int i = 0; i < h.mip_count; i++)
+	{
+		const size_t size = level_size(w, hh, h.pixel_format);
+		if (offset + size > buffer.size())
+			return false;
+		out.levels.push_back({ w, hh, buffer.data() + offset, size });
+		offset += size;
+		w = std::max(1, w / 2);
+		hh = std::max(1, hh / 2);
+	}
+
+	return true;
+}
+
+vector<byte> xs::texture::bake(const vector<byte>& encoded)
+{
+	int width = 0, height = 0, channels = 0;
+	if (!stbi_info_from_memory(
+		reinterpret_cast<const unsigned char*>(encoded.data()),
+		static_cast<int>(encoded.size()),
+		&width, &height, &channels))
+		return {};
+
+	// Single channel images stay single channel, everything else becomes RGBA
+	const format f = channels == 1 ? format::r8 : format::rgba8;
+	const int bpp = bytes_per_pixel(f);
+
+	unsigned char* pixels = stbi_load_from_memory(
+		reinterpret_cast<const unsigned char*>(encoded.data()),
+		static_cast<int>(encoded.size()),
+		&width, &height, &channels,
+		bpp);
+	if (pixels == nullptr)
+		return {};
+
+	// Full chain down to 1x1
+	int mip_count = 1;
+	size_t total = header_size + level_size(width, height, f);
+	for (int w = width, h = height; w > 1 || h > 1; mip_count++)
+	{
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+		total += level_size(w, h, f);
+	}
+
+	vector<byte> buffer(total);
+	size_t offset = 0;
+	internal::write<uint32_t>(buffer, offset, header::MAGIC_NUMBER);
+	internal::write<uint16_t>(buffer, offset, header::VERSION);
+	internal::write<format>(buffer, offset, f);
+	internal::write<uint8_t>(buffer, offset, static_cast<uint8_t>(mip_count));
+	internal::write<uint32_t>(buffer, offset, static_cast<uint32_t>(width));
+	internal::write<uint32_t>(buffer, offset, static_cast<uint32_t>(height));
+	internal::write<uint32_t>(buffer, offset, static_cast<uint32_t>(channels));
+
+	memcpy(buffer.data() + offset, pixels, level_size(width, height, f));
+	stbi_image_free(pixels);
+
+	// Each level is filtered from the one before it
+	int w = width, h = height;
+	for (int i = 1; i < mip_count; i++)
+	{
+		const byte* src = buffer.data() + offset;
+		offset += level_size(w, h, f);
+		const int nw = std::max(1, w / 2);
+		const int nh = std::max(1, h / 2);
+		downsample(src, w, h, buffer.data() + offset, nw, nh, bpp);
+		w = nw;
+		h = nh;
+	}
+
+	return buffer;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Baked textures are images that were decoded at package time and stored
+// ready for upload, with the full mip chain. The layout is a small header
+// followed by the mip levels, largest first, tightly packed:
+//
+//   header | level 0 | level 1 | ... | level (mip_count - 1)
+//
+namespace xs::texture
+{
+	enum class format : uint8_t
+	{
+		rgba8 = 0,
+		r8 = 1
+	};
+
+	struct header
+	{
+		// "XSTX" when read as bytes
+		static constexpr uint32_t MAGIC_NUMBER = 0x58545358;
+		static constexpr uint16_t VERSION = 1;
+
+		uint32_t magic = MAGIC_NUMBER;
+		uint16_t version = VERSION;
+		format pixel_format = format::rgba8;
+		uint8_t mip_count = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t channels = 0;		// Channels in the original file
+	};
+
+	struct level
+	{
+		int width = 0;
+		int height = 0;
+		const std::byte* data = nullptr;
+		std::size_t size = 0;
+	};
+
+	/// A parsed baked texture. The levels point into the buffer it was read from.
+	struct view
+	{
+		header info;
+		std::vector<level> levels;
+	};
+
+	/// Bytes per pixel for a format
+	int bytes_per_pixel(format f);
+
+	/// Check if a file buffer holds a baked texture (cheap, only looks at the header)
+	bool is_baked(const std::vector<std::byte>& buffer);
+
+	/// Parse a baked texture. Returns false if the buffer is not valid.
+	bool read(const std::vector<std::byte>& buffer, view& out);
+
+	/// Decode an image file (png or jpg) and bake it, building the mip chain.
+	/// Returns an empty buffer if the image could not be decoded.
+	std::vector<std::byte> bake(const std::vector<std::byte>& encoded);
+}
@@ -0,0 +1,174 @@
+#include "watcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include "fileio.hpp"
+#include "log.hpp"
+#include "render.hpp"
+#include "script.hpp"
+#include "inspector.hpp"
+#include "profiler.hpp"
+#include "xs.hpp"
+
+using namespace std;
+
+namespace xs::watcher::internal
+{
+	using clock = chrono::steady_clock;
+
+	// Editors often write a file several times in a row, so wait for the
+	// writes to settle before reloading
+	constexpr chrono::milliseconds c_quiet_time(150);
+
+	struct root
+	{
+		string wildcard;
+		string folder;
+	};
+
+	vector<root> roots;
+	mutex pending_mutex;
+	unordered_map<string, clock::time_point> pending;	// Full path to last write
+	atomic<bool> has_pending = false;
+	bool running = false;
+
+	string extension(const string& path);
+	string to_wildcard_path(const string& path);
+}
+
+using namespace xs;
+using namespace xs::watcher::internal;
+
+void xs::watcher::initialize()
+{
+	if (get_run_mode() != run_mode::development)
+		return;
+
+	vector<string> folders;
+	for (const auto& wildcard : { "[game]", "[shared]" })
+	{
+		if (!fileio::has_wildcard(wildcard))
+			continue;
+		auto folder = fileio::get_path(wildcard);
+		roots.push_back({ wildcard, folder });
+		folders.push_back(folder);
+	}
+
+	running = platform::start(folders);
+	if (running)
+		log::info("Watching {} folders for changes", folders.size());
+}
+
+void xs::watcher::shutdown()
+{
+	if (running)
+		platform::stop();
+	running = false;
+	roots.clear();
+	lock_guard<mutex> lock(pending_mutex);
+	pending.clear();
+	has_pending = false;
+}
+
+void xs::watcher::file_changed(const string& path)
+{
+	lock_guard<mutex> lock(pending_mutex);
+	pending[path] = clock::now();
+	has_pending = true;
+}
+
+void xs::watcher::update()
+{
+	// Nothing to do unless a file was written
+	if (!has_pending)
+		return;
+
+	XS_PROFILE_SECTION("xs::watcher::update");
+
+	// Take the files that have not been written to for a while
+	vector<string> changed;
+	{
+		lock_guard<mutex> lock(pending_mutex);
+		const auto now = clock::now();
+		for (auto it = pending.begin(); it != pending.end();)
+		{
+			if (now - it->second >= c_quiet_time)
+			{
+				changed.push_back(it->first);
+				it = pending.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		has_pending = !pending.empty();
+	}
+
+	if (changed.empty())
+		return;
+
+	// New files might have shown up
+	fileio::invalidate_cache();
+
+	bool scripts = false;
+	bool shaders = false;
+	int images = 0;
+	for (const auto& path : changed)
+	{
+		const auto ext = extension(path);
+		if (ext == ".wren")
+			scripts = true;
+		else if (ext == ".vert" || ext == ".frag" || ext == ".glsl")
+			shaders = true;
+		else if (ext == ".png" || ext == ".jpg")
+			images += render::reload_image(to_wildcard_path(path));
+	}
+
+	if (shaders)
+	{
+		log::info("Shaders changed, reloading");
+		render::reload_shaders();
+	}
+
+	if (scripts)
+	{
+		log::info("Scripts changed, reloading");
+		script::shutdown();
+		script::configure();
+		script::initialize();
+	}
+
+	if (images > 1)
+		inspector::notify(inspector::notification_type::success, to_string(images) + " images reloaded", 4.0f);
+}
+
+string xs::watcher::internal::extension(const string& path)
+{
+	const auto dot = path.find_last_of('.');
+	const auto slash = path.find_last_of('/');
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return {};
+	return path.substr(dot);
+}
+
+// Images keep the path they were loaded with, which is usually the wildcard form
+string xs::watcher::internal::to_wildcard_path(const string& path)
+{
+	for (const auto& r : roots)
+	{
+		if (path.size() > r.folder.size() &&
+			path.compare(0, r.folder.size(), r.folder) == 0 &&
+			path[r.folder.size()] == '/')
+			return r.wildcard + path.substr(r.folder.size());
+	}
+	return path;
+}
+
+#if !defined(PLATFORM_LINUX)
+
+bool xs::watcher::platform::start(const std::vector<std::string>&) { return false; }
+void xs::watcher::platform::stop() {}
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace xs::watcher
+{
+	/// Start watching the game and shared folders for changes (development mode only)
+	void initialize();
+
+	/// Stop watching
+	void shutdown();
+
+	/// Reload the assets that changed since the last update (called once per frame)
+	void update();
+
+	/// Report a changed file (full path). Can be called from any thread.
+	void file_changed(const std::string& path);
+}
+
+// Implemented per platform. Platforms without a watcher get the no-op version in watcher.cpp
+namespace xs::watcher::platform
+{
+	/// Start watching the folders (recursively), calling file_changed for every write
+	bool start(const std::vector<std::string>& folders);
+
+	/// Stop watching and join any background thread
+	void stop();
+}
@@ -13,7 +13,18 @@
 #include "inspector.hpp"
 #include "packager.hpp"
 #include "version.hpp"
+#include "loader.hpp"
+#include "jobs.hpp"
+#include "pacing.hpp"
+#include "watcher.hpp"
+#include "profiler.hpp"
+#include "configuration.hpp"
 #include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <json/json.hpp>
 
 // CLI support for PC and Mac only
 #if defined(PLATFORM_PC) || defined(PLATFORM_MAC)
@@ -28,6 +39,32 @@ using namespace xs;
 using namespace std;
 
 static run_mode s_run_mode = run_mode::development;
+static bool s_headless = false;
+
+// CPU time of the parts of the last frame, in milliseconds
+struct frame_timing
+{
+	double update = 0.0;
+	double render = 0.0;
+	double submit = 0.0;
+	double audio = 0.0;
+	double frame = 0.0;
+	double jitter = 0.0;	// How far the frame time was off, from the frame pacing
+};
+static frame_timing s_timing;
+
+// Time not simulated yet, when updating in fixed steps
+static double s_accumulator = 0.0;
+
+using frame_clock = chrono::steady_clock;
+
+static double ms_since(frame_clock::time_point& from)
+{
+	const auto to = frame_clock::now();
+	const double ms = chrono::duration<double, milli>(to - from).count();
+	from = to;
+	return ms;
+}
 
 void xs::set_run_mode(run_mode mode)
 {
@@ -39,6 +76,34 @@ run_mode xs::get_run_mode()
 	return s_run_mode;
 }
 
+void xs::set_headless(bool headless)
+{
+	s_headless = headless;
+}
+
+bool xs::is_headless()
+{
+	return s_headless;
+}
+
+#if defined(PLATFORM_PC) || defined(PLATFORM_MAC)
+// Frame pacing from the command line, empty keeps the project setting
+static bool set_pacing(const std::string& name, double fps)
+{
+	if (name.empty())
+		return true;
+
+	pacing::mode mode;
+	if (!pacing::parse_mode(name, mode))
+	{
+		std::cerr << "Invalid --pacing value: " << name << '\n';
+		return false;
+	}
+	pacing::set_mode(mode, fps);
+	return true;
+}
+#endif
+
 int xs::dispatch(int argc, char* argv[])
 {
 #if defined(PLATFORM_PC) || defined(PLATFORM_MAC)
@@ -52,6 +117,29 @@ int xs::dispatch(int argc, char* argv[])
 	run_cmd.add_argument("path")
 		.help("Path to game project folder or .xs package file")
 		.default_value(std::string("."));
+	run_cmd.add_argument("--trace")
+		.help("Capture this many frames from the start to a Chrome Trace file")
+		.default_value(0)
+		.scan<'i', int>();
+	run_cmd.add_argument("--trace-file")
+		.help("File to write the trace capture to")
+		.default_value(std::string("trace.json"));
+	run_cmd.add_argument("--pacing")
+		.help("Frame pacing instead of the project setting: vsync, adaptive, fps or uncapped")
+		.default_value(std::string(""));
+	run_cmd.add_argument("--fps")
+		.help("Target frame rate for the fps pacing")
+		.default_value(0.0)
+		.scan<'g', double>();
+	run_cmd.add_argument("--record")
+		.help("Record the input of every frame to this file, for replaying it later")
+		.default_value(std::string(""));
+	run_cmd.add_argument("--replay")
+		.help("Play back an input recording instead of reading the devices")
+		.default_value(std::string(""));
+	run_cmd.add_argument("--log-file")
+		.help("Also write the log to this file")
+		.default_value(std::string(""));
 
 	// Run subcommand - runs a project folder or .xs package
 	argparse::ArgumentParser version_cmd("version");
@@ -67,10 +155,69 @@ int xs::dispatch(int argc, char* argv[])
 		.default_value(std::string(""))
 		.nargs(argparse::nargs_pattern::optional);
 
+	// Audio benchmark subcommand - mixes audio offline, no device needed
+	argparse::ArgumentParser audio_bench_cmd("audio-bench");
+	audio_bench_cmd.add_description("Benchmark the audio mixer offline and optionally write the mix to a WAV file");
+	audio_bench_cmd.add_argument("--voices")
+		.help("Number of voices to mix")
+		.default_value(32)
+		.scan<'i', int>();
+	audio_bench_cmd.add_argument("--seconds")
+		.help("Seconds of audio to mix")
+		.default_value(10.0)
+		.scan<'g', double>();
+	audio_bench_cmd.add_argument("--output")
+		.help("WAV file to write the mix to, for checking the output")
+		.default_value(std::string(""));
+
+	// Benchmark subcommand - runs a game with a fixed timestep and reports frame timings
+	argparse::ArgumentParser bench_cmd("bench");
+	bench_cmd.add_description("Run a game for a number of frames with a fixed timestep and report frame timings");
+	bench_cmd.add_argument("path")
+		.help("Path to game project folder or .xs package file")
+		.default_value(std::string("."));
+	bench_cmd.add_argument("--frames")
+		.help("Number of frames to measure")
+		.default_value(600)
+		.scan<'i', int>();
+	bench_cmd.add_argument("--warmup")
+		.help("Number of frames to run before measuring")
+		.default_value(30)
+		.scan<'i', int>();
+	bench_cmd.add_argument("--dt")
+		.help("Fixed timestep in seconds, as a number or a fraction like 1/60")
+		.default_value(std::string("1/60"));
+	bench_cmd.add_argument("--headless")
+		.help("Render offscreen without a display, turn off vsync and mix audio offline")
+		.default_value(false)
+		.implicit_value(true);
+	bench_cmd.add_argument("--output")
+		.help("JSON file to write the summary to")
+		.default_value(std::string(""));
+	bench_cmd.add_argument("--pacing")
+		.help("Frame pacing instead of the project setting: vsync, adaptive, fps or uncapped")
+		.default_value(std::string(""));
+	bench_cmd.add_argument("--fps")
+		.help("Target frame rate for the fps pacing")
+		.default_value(0.0)
+		.scan<'g', double>();
+	bench_cmd.add_argument("--replay")
+		.help("Play back an input recording with its dt, for as many frames as it has")
+		.default_value(std::string(""));
+	bench_cmd.add_argument("--seed")
+		.help("Seed for Random.new() in scripts (a replay uses the seed it was recorded with)")
+		.default_value(1)
+		.scan<'i', int>();
+	bench_cmd.add_argument("--log-file")
+		.help("Also write the log to this file")
+		.default_value(std::string(""));
+
 	// Add subcommands to main program
 	program.add_subparser(run_cmd);
 	program.add_subparser(package_cmd);
 	program.add_subparser(version_cmd);
+	program.add_subparser(audio_bench_cmd);
+	program.add_subparser(bench_cmd);
 
 	try {
 		program.parse_args(argc, argv);
@@ -101,8 +248,84 @@ int xs::dispatch(int argc, char* argv[])
 			xs::set_run_mode(xs::run_mode::development);
 			game_path = path;
 		}
+
+		const int trace_frames = run_cmd.get<int>("--trace");
+		if (trace_frames > 0)
+			profiler::capture(trace_frames, run_cmd.get<std::string>("--trace-file"));
+
+		if (!set_pacing(run_cmd.get<std::string>("--pacing"), run_cmd.get<double>("--fps")))
+			return 1;
+
+		// A recording keeps the seed, so a replay gets the same random numbers
+		uint32_t seed = (uint32_t)chrono::system_clock::now().time_since_epoch().count();
+		const std::string replay = run_cmd.get<std::string>("--replay");
+		if (!replay.empty() && !input::start_replay(replay, seed))
+			return 1;
+		const std::string record = run_cmd.get<std::string>("--record");
+		if (!record.empty() && !input::start_recording(record, seed))
+			return 1;
+		if (!replay.empty() || !record.empty())
+			script::set_random_seed(seed);
+
+		const std::string log_file = run_cmd.get<std::string>("--log-file");
+		if (!log_file.empty())
+			log::set_file(log_file);
+
 		return xs::main(game_path);
 	}
+	else if (program.is_subcommand_used("audio-bench")) {
+		return audio_bench(
+			audio_bench_cmd.get<int>("--voices"),
+			audio_bench_cmd.get<double>("--seconds"),
+			audio_bench_cmd.get<std::string>("--output"));
+	}
+	else if (program.is_subcommand_used("bench")) {
+		std::string path = bench_cmd.get<std::string>("path");
+		std::filesystem::path fs_path(path);
+		if (fs_path.extension() == ".xs")
+			xs::set_run_mode(xs::run_mode::packaged);
+		else
+			xs::set_run_mode(xs::run_mode::development);
+
+		// Accept both 0.0166 and 1/60
+		const std::string dt_arg = bench_cmd.get<std::string>("--dt");
+		double dt = 0.0;
+		try {
+			const auto slash = dt_arg.find('/');
+			if (slash == std::string::npos)
+				dt = std::stod(dt_arg);
+			else
+				dt = std::stod(dt_arg.substr(0, slash)) / std::stod(dt_arg.substr(slash + 1));
+		}
+		catch (const std::exception&) {
+			dt = 0.0;
+		}
+		if (!(dt > 0.0)) {
+			std::cerr << "Invalid --dt value: " << dt_arg << '\n';
+			return 1;
+		}
+
+		if (!set_pacing(bench_cmd.get<std::string>("--pacing"), bench_cmd.get<double>("--fps")))
+			return 1;
+
+		uint32_t seed = (uint32_t)bench_cmd.get<int>("--seed");
+		const std::string replay = bench_cmd.get<std::string>("--replay");
+		if (!replay.empty() && !input::start_replay(replay, seed))
+			return 1;
+		script::set_random_seed(seed);
+
+		const std::string log_file = bench_cmd.get<std::string>("--log-file");
+		if (!log_file.empty())
+			log::set_file(log_file);
+
+		xs::set_headless(bench_cmd.get<bool>("--headless"));
+		return bench(
+			path,
+			bench_cmd.get<int>("--frames"),
+			bench_cmd.get<int>("--warmup"),
+			dt,
+			bench_cmd.get<std::string>("--output"));
+	}
 	else if (program.is_subcommand_used("package")) {
 		xs::set_run_mode(xs::run_mode::packaging);
 		std::string input = package_cmd.get<std::string>("input");
@@ -129,6 +352,7 @@ int xs::package(std::string& input, std::string& output)
 	fileio::initialize(input);
 	data::initialize();
 	script::configure();
+	jobs::initialize();
 
 	// Generate output path if not provided
 	if (output.empty()) {
@@ -153,11 +377,134 @@ int xs::package(std::string& input, std::string& output)
 	else
 		xs::log::error("Failed to create package");
 
+	jobs::shutdown();
 	data::shutdown();
 #endif
 	return 0;
 }
 
+int xs::audio_bench(int voices, double seconds, const std::string& output)
+{
+	log::initialize();
+
+	simple_audio::initialize_offline(48000);
+	const double cost = simple_audio::benchmark(voices, seconds, output);
+	simple_audio::shutdown();
+
+	log::flush();
+	return cost >= 0.0 ? 0 : 1;
+}
+
+int xs::bench(const std::string& game_path, int frames, int warmup, double dt, const std::string& output)
+{
+	frames = std::max(frames, 1);
+	warmup = std::max(warmup, 0);
+
+	xs::initialize(game_path);
+
+	// Headless there is no audio device pulling samples, so mix them here
+	const int sample_rate = 48000;
+	std::vector<float> audio_buffer;
+	double audio_owed = 0.0;
+
+	// A replay runs for as long as the recording, with the dt of each recorded frame
+	const bool replay = input::replaying();
+
+	std::vector<frame_timing> timings;
+	timings.reserve(frames);
+	for (int i = 0; (replay ? input::replaying() : i < warmup + frames) && !device::should_close(); i++)
+	{
+		XS_AUTORELEASE_POOL_BEGIN
+		const double frame_dt = replay ? input::replay_dt() : dt;
+		xs::update(frame_dt);
+		if (s_headless)
+		{
+			audio_owed += frame_dt * sample_rate;
+			const int count = (int)audio_owed;
+			audio_owed -= count;
+			audio_buffer.resize((size_t)count * 2);
+			auto time = frame_clock::now();
+			simple_audio::render(audio_buffer.data(), count);
+			const double ms = ms_since(time);
+			s_timing.audio += ms;
+			s_timing.frame += ms;
+		}
+		pacing::wait();
+		s_timing.jitter = pacing::get_stats().jitter_ms;
+		if (i >= warmup)
+			timings.push_back(s_timing);
+		XS_AUTORELEASE_POOL_END
+	}
+
+	xs::shutdown();
+
+	if (timings.empty())
+	{
+		std::fprintf(stderr, "No frames were measured\n");
+		return 1;
+	}
+
+	// Nearest rank percentiles over the measured frames
+	auto percentiles = [&timings](double frame_timing::* field)
+	{
+		std::vector<double> values;
+		values.reserve(timings.size());
+		for (const auto& t : timings)
+			values.push_back(t.*field);
+		std::sort(values.begin(), values.end());
+		auto rank = [&values](double p)
+		{
+			const size_t n = values.size();
+			const size_t i = (size_t)std::ceil(p * (double)n);
+			return values[std::clamp<size_t>(i, 1, n) - 1];
+		};
+		nlohmann::json j;
+		j["p50"] = rank(0.50);
+		j["p95"] = rank(0.95);
+		j["p99"] = rank(0.99);
+		j["max"] = values.back();
+		return j;
+	};
+
+	const std::pair<const char*, double frame_timing::*> sections[] = {
+		{ "update", &frame_timing::update },
+		{ "render", &frame_timing::render },
+		{ "submit", &frame_timing::submit },
+		{ "audio", &frame_timing::audio },
+		{ "frame", &frame_timing::frame },
+		{ "jitter", &frame_timing::jitter }
+	};
+
+	nlohmann::json summary;
+	summary["frames"] = timings.size();
+	summary["warmup"] = warmup;
+	summary["dt"] = dt;
+	summary["headless"] = s_headless;
+	summary["pacing"] = pacing::mode_name(pacing::get_mode());
+	summary["replay"] = replay;
+	nlohmann::json& timings_ms = summary["timings_ms"];
+	for (const auto& [name, field] : sections)
+		timings_ms[name] = percentiles(field);
+
+	std::printf("%-8s %9s %9s %9s %9s  (ms, %d frames)\n", "", "p50", "p95", "p99", "max", (int)timings.size());
+	for (const auto& [name, field] : sections)
+	{
+		const auto& t = timings_ms[name];
+		std::printf("%-8s %9.3f %9.3f %9.3f %9.3f\n", name,
+			t["p50"].get<double>(), t["p95"].get<double>(), t["p99"].get<double>(), t["max"].get<double>());
+	}
+
+	const std::string json = summary.dump();
+	std::printf("%s\n", json.c_str());
+	if (!output.empty() && !fileio::write_text_file(summary.dump(4), output))
+	{
+		std::fprintf(stderr, "Could not write %s\n", output.c_str());
+		return 1;
+	}
+
+	return replay || (int)timings.size() == frames ? 0 : 1;
+}
+
 void xs::initialize(const std::string& game_path)
 {
 	log::initialize();
@@ -166,16 +513,26 @@ void xs::initialize(const std::string& game_path)
 	data::initialize();
 	script::configure();
 	device::initialize();
+	pacing::initialize();
 	render::initialize();
+	jobs::initialize();
+	loader::initialize();
 	input::initialize();
 	audio::initialize();
-	simple_audio::initialize();
+	if (s_headless)
+		simple_audio::initialize_offline(48000);
+	else
+		simple_audio::initialize();
 	inspector::initialize();
+	watcher::initialize();
 	script::initialize();
 }
 
 void xs::shutdown()
 {
+	watcher::shutdown();
+	loader::shutdown();
+	jobs::shutdown();
 	inspector::shutdown();
 	simple_audio::shutdown();
 	audio::shutdown();
@@ -185,26 +542,79 @@ void xs::shutdown()
 	script::shutdown();
 	account::shutdown();
 	data::shutdown();
+	log::shutdown();
 }
 
 void xs::update(double dt)
 {
 	device::poll_events();
 	input::update(dt);
+	loader::update();
+	jobs::update();
+	watcher::update();
 
+	auto frame_start = frame_clock::now();
+	auto time = frame_start;
+	s_timing = frame_timing();
 	if (!inspector::paused())
 	{
 		render::clear();
-		script::update(dt);
+		ms_since(time);
+
+		// With a fixed timestep the game is updated as many steps as fit in the time that passed
+		// and rendered with how far it is into the next step, so the rate of updates does not
+		// follow the display rate
+		double alpha = 1.0;
+		if (configuration::fixed_timestep())
+		{
+			const double step = 1.0 / configuration::update_rate();
+			const int max_updates = configuration::max_updates_per_frame();
+			s_accumulator += dt;
+			int updates = 0;
+			while (s_accumulator >= step && updates < max_updates)
+			{
+				script::update(step);
+				s_accumulator -= step;
+				updates++;
+			}
+
+			// Too far behind to catch up, drop the backlog rather than fall further behind
+			if (s_accumulator >= step)
+				s_accumulator = std::fmod(s_accumulator, step);
+			alpha = s_accumulator / step;
+		}
+		else
+		{
+			script::update(dt);
+		}
+		s_timing.update = ms_since(time);
 		audio::update(dt);
 		simple_audio::update(dt);
-		script::render();
+		s_timing.audio = ms_since(time);
+		script::render(alpha);
+		s_timing.render = ms_since(time);
 	}
 
 	device::begin_frame();
+	ms_since(time);
 	render::render();
+	s_timing.submit = ms_since(time);
 	inspector::render(dt);
-	device::end_frame();
+
+	// The render thread presents the frame once it has drawn it
+	if (!render::has_render_thread())
+		device::end_frame();
+	s_timing.frame = ms_since(frame_start);
+
+	// Counter tracks for profiler captures
+	if (profiler::capturing())
+	{
+		const auto stats = render::get_stats();
+		profiler::counter("Draw calls", stats.draw_calls);
+		profiler::counter("Sprites", stats.sprites);
+		profiler::counter("Script heap (KB)", (double)script::get_bytes_allocated() / 1024.0);
+	}
+	profiler::end_frame();
 }
 
 int xs::main(const std::string& game_path)
@@ -218,8 +628,13 @@ int xs::main(const std::string& game_path)
 		auto elapsed = current_time - prev_time;
 		prev_time = current_time;
 		auto dt = std::chrono::duration<double>(elapsed).count();
-		dt = std::min(dt, 0.03333);
+		// A fixed timestep limits catching up by itself, only guard against long stalls
+		dt = std::min(dt, configuration::fixed_timestep() ? 0.25 : 0.03333);
+		// A replay plays out with the time steps it was recorded with
+		if (input::replaying())
+			dt = input::replay_dt();
 		xs::update((float)dt);
+		pacing::wait();
 		XS_AUTORELEASE_POOL_END
 	}
 	xs::shutdown();
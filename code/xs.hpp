@@ -16,10 +16,19 @@ namespace xs
 	void set_run_mode(run_mode mode);
 	run_mode get_run_mode();
 
+	/// Run without showing the window, without vsync and with audio mixed offline (for benchmarks)
+	void set_headless(bool headless);
+	bool is_headless();
+
 	int dispatch(int argc, char* argv[]);
 
 	int package(std::string& input, std::string& output);
 
+	int audio_bench(int voices, double seconds, const std::string& output);
+
+	/// Run a game for a number of frames with a fixed timestep and report the frame timings
+	int bench(const std::string& game_path, int frames, int warmup, double dt, const std::string& output);
+
 	void initialize(const std::string& game_path = "");
 
 	void shutdown();
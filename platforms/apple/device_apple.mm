@@ -281,6 +281,17 @@ double device::hdpi_scaling()
     return SDL_GetWindowDisplayScale(internal::window);
 }
 
+// Metal has no context that is current on a thread
+void device::acquire_context() {}
+
+void device::release_context() {}
+
+// The Metal layer presents in step with the display
+bool device::set_swap_interval(int interval)
+{
+    return interval == 1;
+}
+
 void device::set_fullscreen(bool fullscreen)
 {
     if (!internal::window)
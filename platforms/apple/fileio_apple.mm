@@ -33,13 +33,13 @@ void fileio::initialize(const std::string& game_path)
     string user_path = [user_path_oc.stringByExpandingTildeInPath UTF8String];
     if (!filesystem::exists(user_path))
         filesystem::create_directory(user_path);
-    internal::wildcards["[user]"] = user_path;
+    add_wildcard("[user]", user_path);
 
     // The save location for the game
     string game_save_path = user_path + "/save";
     if (!filesystem::exists(game_save_path))
         filesystem::create_directory(game_save_path);
-    internal::wildcards["[save]"] = game_save_path;
+    add_wildcard("[save]", game_save_path);
 
     // Determine game folder path
     // Priority: CLI argument > bundle resources > default sample
@@ -68,6 +68,23 @@ void xs::input::update(double dt)
     }
 }
 
+// Input recording is only implemented with the SDL input
+bool xs::input::start_recording(const std::string& path, uint32_t seed)
+{
+    log::error("Input recording is not supported on this platform");
+    return false;
+}
+
+bool xs::input::start_replay(const std::string& path, uint32_t& seed)
+{
+    log::error("Input replay is not supported on this platform");
+    return false;
+}
+
+bool xs::input::replaying() { return false; }
+
+double xs::input::replay_dt() { return 0.0; }
+
 double xs::input::get_axis(gamepad_axis axis)
 {
     if (gamepad == nil)
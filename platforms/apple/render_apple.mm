@@ -538,6 +538,16 @@ void xs::render::clear()
     sprite_queue.clear();
 }
 
+void xs::render::reload_shaders()
+{
+    // Metal shaders are compiled into the app bundle, nothing to reload
+}
+
+bool xs::render::has_render_thread()
+{
+    return false;
+}
+
 void xs::render::create_texture_with_data(
     xs::render::image& img,
     uchar* data)
@@ -565,6 +575,54 @@ void xs::render::create_texture_with_data(
     }
 }
 
+void xs::render::create_texture_with_levels(
+    xs::render::image& img,
+    const xs::texture::view& tex)
+{
+    // Single channel textures are expanded, the sprite shader samples RGBA
+    if (tex.info.pixel_format == texture::format::r8)
+    {
+        const auto& level = tex.levels[0];
+        vector<uchar> rgba(level.size * 4);
+        const auto* src = reinterpret_cast<const uchar*>(level.data);
+        for (size_t i = 0; i < level.size; i++)
+        {
+            rgba[i * 4 + 0] = src[i];
+            rgba[i * 4 + 1] = src[i];
+            rgba[i * 4 + 2] = src[i];
+            rgba[i * 4 + 3] = 255;
+        }
+        create_texture_with_data(img, rgba.data());
+        return;
+    }
+
+    @autoreleasepool {
+    MTLTextureDescriptor* texture_descriptor = [[MTLTextureDescriptor alloc] init];
+    texture_descriptor.pixelFormat = MTLPixelFormatRGBA8Uint;   // 0-255 RGBA
+    texture_descriptor.width = img.width;
+    texture_descriptor.height= img.height;
+    texture_descriptor.mipmapLevelCount = tex.levels.size();
+    texture_descriptor.usage = MTLTextureUsageShaderRead;
+    texture_descriptor.storageMode = MTLStorageModeShared;
+    img.texture = [_device newTextureWithDescriptor:texture_descriptor];
+
+    for (size_t i = 0; i < tex.levels.size(); i++)
+    {
+        const auto& level = tex.levels[i];
+        MTLRegion region = {
+            { 0, 0, 0 },
+            { (NSUInteger)level.width, (NSUInteger)level.height, 1 }
+        };
+
+        [img.texture
+         replaceRegion:region
+         mipmapLevel:i
+         withBytes:level.data
+         bytesPerRow:level.width * 4];
+    }
+    }
+}
+
 int xs::render::create_shape(
 	int image_id,
 	const float *positions,
@@ -57,13 +57,13 @@ void xs::fileio::initialize(const std::string& game_path)
 	{
 		fs::create_directories(xs_user_path);
 	}
-	internal::wildcards["[user]"] = xs_user_path;
+	add_wildcard("[user]", xs_user_path);
 
 	// The save location for the game
 	string game_save_path = xs_user_path + "/save";
 	if (!fs::exists(game_save_path))
 		fs::create_directory(game_save_path);
-	internal::wildcards["[save]"] = game_save_path;
+	add_wildcard("[save]", game_save_path);
 
 	// Determine game folder path
 	// Priority: CLI argument > settings.json > default sample
@@ -0,0 +1,166 @@
+#include "watcher.hpp"
+
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "log.hpp"
+#include "profiler.hpp"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+using namespace xs;
+
+namespace xs::watcher::inotify
+{
+	// Only the events that mean a file is done being written
+	constexpr uint32_t c_file_events = IN_CLOSE_WRITE | IN_MOVED_TO;
+	constexpr uint32_t c_folder_events = c_file_events | IN_CREATE;
+
+	int inotify_fd = -1;
+	int wake_fd = -1;		// Written to on stop, to get the thread out of poll
+	thread worker;
+	unordered_map<int, string> folders;	// Watch descriptor to folder path
+
+	void add_folder(const string& folder);
+	void add_folder_tree(const string& root);
+	void run();
+}
+
+using namespace xs::watcher::inotify;
+
+bool xs::watcher::platform::start(const vector<string>& roots)
+{
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0)
+	{
+		log::warn("Could not start the file watcher (inotify_init1 failed)");
+		return false;
+	}
+
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wake_fd < 0)
+	{
+		close(inotify_fd);
+		inotify_fd = -1;
+		log::warn("Could not start the file watcher (eventfd failed)");
+		return false;
+	}
+
+	for (const auto& root : roots)
+		add_folder_tree(root);
+
+	worker = thread(run);
+	return true;
+}
+
+void xs::watcher::platform::stop()
+{
+	if (inotify_fd < 0)
+		return;
+
+	uint64_t one = 1;
+	[[maybe_unused]] auto written = write(wake_fd, &one, sizeof(one));
+	if (worker.joinable())
+		worker.join();
+
+	close(inotify_fd);
+	close(wake_fd);
+	inotify_fd = -1;
+	wake_fd = -1;
+	folders.clear();
+}
+
+void xs::watcher::inotify::add_folder(const string& folder)
+{
+	const int wd = inotify_add_watch(inotify_fd, folder.c_str(), c_folder_events);
+	if (wd < 0)
+	{
+		log::warn("Could not watch folder {}", folder);
+		return;
+	}
+	folders[wd] = folder;
+}
+
+// inotify is not recursive, so every sub folder gets its own watch
+void xs::watcher::inotify::add_folder_tree(const string& root)
+{
+	std::error_code ec;
+	if (!fs::is_directory(root, ec))
+		return;
+
+	add_folder(root);
+	for (auto it = fs::recursive_directory_iterator(root, ec); it != fs::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (ec)
+			break;
+
+		// Skip hidden folders (.git and such)
+		const auto name = it->path().filename().string();
+		if (!name.empty() && name[0] == '.')
+		{
+			if (it->is_directory(ec))
+				it.disable_recursion_pending();
+			continue;
+		}
+
+		if (it->is_directory(ec))
+			add_folder(it->path().string());
+	}
+}
+
+void xs::watcher::inotify::run()
+{
+	profiler::set_thread_name("File watcher");
+	alignas(inotify_event) char buffer[16 * 1024];
+	pollfd fds[2] = {
+		{ inotify_fd, POLLIN, 0 },
+		{ wake_fd, POLLIN, 0 }
+	};
+
+	while (true)
+	{
+		// Sleeps until something happens, no cost while idle
+		if (poll(fds, 2, -1) < 0)
+			continue;
+
+		if (fds[1].revents & POLLIN)
+			return;
+
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		while (true)
+		{
+			const ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+			if (length <= 0)
+				break;
+
+			for (char* ptr = buffer; ptr < buffer + length;)
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+				ptr += sizeof(inotify_event) + event->len;
+
+				auto it = folders.find(event->wd);
+				if (it == folders.end() || event->len == 0)
+					continue;
+
+				const string path = it->second + "/" + event->name;
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						add_folder_tree(path);
+				}
+				else if (event->mask & c_file_events)
+				{
+					watcher::file_changed(path);
+				}
+			}
+		}
+	}
+}
@@ -7,12 +7,22 @@ namespace xs::simple_audio
 	void initialize() {}
 	void shutdown() {}
 	void update(double dt) {}
+	void initialize_offline(int sample_rate) {}
+	int render(float* out, int frames) { return 0; }
+	bool render_to_file(const std::string& filename, double seconds) { return false; }
+	double benchmark(int voices, double seconds, const std::string& output) { return -1.0; }
 
 	int load(const std::string& filename) { return -1; }
+	int load_stream(const std::string& filename) { return -1; }
+	std::vector<int> load_many(const std::vector<std::string>& filenames) { return std::vector<int>(filenames.size(), -1); }
 	int play(int sound_id, double volume) { return -1; }
+	int play(int sound_id, double volume, double pan, double delay) { return -1; }
 	void stop(int sound_id) {}
 	void stop_all() {}
 	bool is_playing(int sound_id) { return false; }
+	void set_max_voices(int sound_id, int max_voices) {}
+	void set_priority(int sound_id, int priority) {}
 	void set_volume(int sound_id, double volume) {}
+	void set_pan(int sound_id, double pan) {}
 	double get_volume(int sound_id) { return 0.0; }
 }
@@ -36,7 +36,7 @@ void fileio::initialize(const std::string& game_path)
 		string xs_user_path = string(pValue) + string("\\xs");
 		if (!fs::exists(xs_user_path))
 			fs::create_directory(xs_user_path);
-		internal::wildcards["[user]"] = xs_user_path;
+		add_wildcard("[user]", xs_user_path);
 	}
 	else
 	{
@@ -49,7 +49,7 @@ void fileio::initialize(const std::string& game_path)
 	string game_save_path = xs_user_path + "\\save";
 	if (!fs::exists(game_save_path))
 		fs::create_directory(game_save_path);
-	internal::wildcards["[save]"] = game_save_path;
+	add_wildcard("[save]", game_save_path);
 
 	// Determine game folder path
 	// Priority: CLI argument > settings.json > default sample